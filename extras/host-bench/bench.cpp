@@ -0,0 +1,377 @@
+// AURA host benchmarks: the engine from src/AURA.cpp, built for Linux
+// (AURA_HOST), timed on synthetic TOON packs of 100, 1k and 10k entries.
+// Fixed seeds throughout, so runs are comparable: gate engine changes on
+// ns/query, allocations/query and parse MB/s.
+#include "../../src/AURA.cpp"
+
+#include <chrono>
+#include <functional>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+static const int kPasses = 3;     // best of
+static const int kQueries = 2000;
+
+static uint64_t nowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// A TOON pack of n entries: 4 keywords each from a vocabulary of
+// n / 2 + 64 words, answers of 30 filler words.
+static std::string makePack(int n, uint32_t seed) {
+  static const char *words[] = {"machine", "control", "voltage", "current",
+                                "process", "station", "network", "digital",
+                                "systems", "sensors", "outputs", "signals",
+                                "program", "vehicle", "battery", "console"};
+  uint32_t vocab = n / 2 + 64;
+  std::string t = "name: bench\nversion: 1\nthreshold: 2\ntemperature: 0.5\n";
+  t += "entries[" + std::to_string(n) + "]{t,k,a}:\n";
+  char row[96];
+  for (int i = 0; i < n; i++) {
+    snprintf(row, sizeof(row), "  \"Topic %d\",\"kw%u:2 kw%u kw%u kw%u\",\"",
+             i, (unsigned)(benchRng(seed) % vocab),
+             (unsigned)(benchRng(seed) % vocab),
+             (unsigned)(benchRng(seed) % vocab),
+             (unsigned)(benchRng(seed) % vocab));
+    t += row;
+    for (int w = 0; w < 30; w++) {
+      t += words[benchRng(seed) % 16];
+      t += w < 29 ? ' ' : '"';
+    }
+    t += '\n';
+  }
+  return t;
+}
+
+// Prompts over the same vocabulary: direct hits, stems ("kw12s"), and
+// plain-English misses, all behind everyday question words.
+static std::vector<String> makePrompts(int n, uint32_t seed, int count) {
+  static const char *lead[] = {"what is", "tell me about", "explain",
+                               "how does", "apa itu", "why do we need"};
+  static const char *miss[] = {"the weather in paris", "a good recipe",
+                               "football results", "my horoscope"};
+  uint32_t vocab = n / 2 + 64;
+  std::vector<String> out;
+  char b[96];
+  for (int i = 0; i < count; i++) {
+    const char *l = lead[benchRng(seed) % 6];
+    switch (benchRng(seed) % 4) {
+      case 0:
+        snprintf(b, sizeof(b), "%s %s", l, miss[benchRng(seed) % 4]);
+        break;
+      case 1:
+        snprintf(b, sizeof(b), "%s kw%us", l,
+                 (unsigned)(benchRng(seed) % vocab));
+        break;
+      default:
+        snprintf(b, sizeof(b), "%s kw%u and kw%u", l,
+                 (unsigned)(benchRng(seed) % vocab),
+                 (unsigned)(benchRng(seed) % vocab));
+    }
+    out.push_back(b);
+  }
+  return out;
+}
+
+struct Timing {
+  double ns, allocs;
+};
+
+// Best-of-kPasses time of fn over `count` items, after one warm-up pass.
+template <typename F>
+static Timing timeEach(int count, F fn) {
+  for (int i = 0; i < count; i++) fn(i);
+  Timing best = {1e30, 0};
+  for (int p = 0; p < kPasses; p++) {
+    uint32_t a0 = gAllocs;
+    uint64_t t0 = nowNs();
+    for (int i = 0; i < count; i++) fn(i);
+    double ns = (nowNs() - t0) / (double)count;
+    if (ns < best.ns) best = {ns, (gAllocs - a0) / (double)count};
+  }
+  return best;
+}
+
+static double mbps(size_t bytes, double ns) { return bytes / ns * 1e3; }
+
+static void row(const char *stage, int n, Timing t) {
+  printf("  %-20s %6d %12.0f %10.2f\n", stage, n, t.ns, t.allocs);
+}
+
+// aura-bench pack in.toon out.toon: store a pack as TZ1, as the device
+// would, for an upload or a fetch that is a fraction of the text.
+static int packFile(const char *in, const char *out) {
+  hostFsRoot = "";
+  File f = LittleFS.open(in, "r");
+  if (!f) {
+    perror(in);
+    return 1;
+  }
+  String text = f.readString();
+  f.close();
+  PackFile src;
+  ToonPack hdr;
+  String err;
+  int count, line;
+  src.open((const uint8_t *)text.c_str(), text.length());
+  if (!validateToon(src, hdr, count, err, line)) {
+    fprintf(stderr, "%s: %s (line %d)\n", in, err.c_str(), line);
+    return 1;
+  }
+  if (!writePack(out, (const uint8_t *)text.c_str(), text.length())) {
+    perror(out);
+    return 1;
+  }
+  PackFile z;
+  z.open(out);
+  printf("%s: %d entries, %u -> %u bytes (%.2fx)\n", out, count,
+         (unsigned)z.size, (unsigned)z.stored, z.size / (double)z.stored);
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  if (argc == 4 && !strcmp(argv[1], "pack")) return packFile(argv[2], argv[3]);
+  char root[] = "/tmp/aura-bench-XXXXXX";
+  if (!mkdtemp(root)) {
+    perror("mkdtemp");
+    return 1;
+  }
+  hostFsRoot = root;
+  hostSerialEcho = argc > 1 && !strcmp(argv[1], "-v");
+  const int sizes[] = {100, 1000, 10000};
+
+  printf("AURA host bench — seed 1, best of %d passes, %d prompts per pack\n\n",
+         kPasses, kQueries);
+  printf("parse      entries      bytes  validate MB/s  build MB/s  "
+         "load MB/s  arena B\n");
+  for (int n : sizes) {
+    std::string pack = makePack(n, 1);
+    const uint8_t *bytes = (const uint8_t *)pack.data();
+    File f = LittleFS.open(MODEL_PATH, "w");
+    f.write(bytes, pack.size());
+    f.close();
+
+    Timing v = timeEach(1, [&](int) {
+      ToonPack hdr;
+      String err;
+      int count, line;
+      PackFile src;
+      src.open(bytes, pack.size());
+      validateToon(src, hdr, count, err, line);
+    });
+    Timing b = timeEach(1, [&](int) {
+      Model m;
+      String err;
+      int line;
+      PackFile src;
+      src.open(bytes, pack.size());
+      buildModel(src, 0, 0, nullptr, m, err, line);
+      releaseModel(m);
+    });
+    Timing l = timeEach(1, [&](int) { loadModels(); });
+    LiveModels live;
+    printf("           %7d %10u %14.1f %11.1f %10.1f %8u\n", n,
+           (unsigned)pack.size(), mbps(pack.size(), v.ns),
+           mbps(pack.size(), b.ns), mbps(pack.size(), l.ns),
+           (unsigned)live->packs[0]->img->size);
+  }
+
+  // The longest row the parser takes, and one byte more: refused at its
+  // line, not cut short.
+  printf("\nlong line  bytes    result\n");
+  for (size_t over : {0, 1}) {
+    std::string row = "  \"Long\",\"long:2\",\"";
+    row.append(MAX_TOON_LINE + over - row.size() - 1, 'x');
+    row += "\"";
+    std::string pack = "name: long\nthreshold: 1\nentries[1]{t,k,a}:\n" +
+                       row + "\n";
+    ToonPack hdr;
+    String err;
+    int count, line;
+    PackFile src;
+    src.open((const uint8_t *)pack.data(), pack.size());
+    bool ok = validateToon(src, hdr, count, err, line);
+    printf("           %5u    %s\n", (unsigned)row.size(),
+           ok ? "accepted" : (err + " at line " + line).c_str());
+  }
+
+  printf("\nTZ1        entries      bytes     stored  ratio  pack MB/s  "
+         "load MB/s  answer ns\n");
+  for (int n : sizes) {
+    std::string pack = makePack(n, 1);
+    const uint8_t *bytes = (const uint8_t *)pack.data();
+    Timing w = timeEach(1, [&](int) {
+      writePack(MODEL_PATH, bytes, pack.size());
+    });
+    Timing l = timeEach(1, [&](int) { loadModels(); });
+    LiveModels live;
+    Model &m = *live->packs[0];
+    PackFile f;
+    f.open(MODEL_PATH);
+    Timing a = timeEach(kQueries, [&](int i) {  // mostly LRU misses
+      modelAnswer(m, (i * 7919u) % m.nEntries);
+    });
+    printf("           %7d %10u %10u %6.2f %10.1f %10.1f %10.0f\n", n,
+           (unsigned)pack.size(), (unsigned)f.stored,
+           pack.size() / (double)f.stored, mbps(pack.size(), w.ns),
+           mbps(pack.size(), l.ns), a.ns);
+  }
+
+  printf("\nquery      stage               entries     ns/query  allocs/q\n");
+  for (int n : sizes) {
+    std::string pack = makePack(n, 1);
+    File f = LittleFS.open(MODEL_PATH, "w");
+    f.write((const uint8_t *)pack.data(), pack.size());
+    f.close();
+    loadModels();
+    LiveModels live;
+    hostSeed(1);
+
+    std::vector<String> prompts = makePrompts(n, 7, kQueries);
+    std::vector<Tokens> toks(kQueries);
+    for (int i = 0; i < kQueries; i++)
+      tokenizePrompt(prompts[i], toks[i]);
+    volatile int sink = 0;
+
+    Tokens t;
+    row("tokenizePrompt", n, timeEach(kQueries, [&](int i) {
+          tokenizePrompt(prompts[i], t);
+          sink = sink + t.n;
+        }));
+    row("rankEntries", n, timeEach(kQueries, [&](int i) {
+          sink = sink + rankEntries(*live->packs[0], toks[i].t, toks[i].n).bestScore;
+        }));
+    row("askModel", n, timeEach(kQueries, [&](int i) {
+          sink = sink + askModel(*live, toks[i]).length();
+        }));
+    row("processPrompt", n, timeEach(kQueries, [&](int i) {
+          sink = sink + processPrompt(prompts[i]).length();
+        }));
+    // the repeat prompts again, with the cache emptied before each one
+    row("processPrompt 8 cold", n, timeEach(kQueries, [&](int i) {
+          for (auto &c : gPromptCache.slot) c.used = 0;
+          sink = sink + processPrompt(prompts[i % 8]).length();
+        }));
+    row("processPrompt repeat", n, timeEach(kQueries, [&](int i) {
+          sink = sink + processPrompt(prompts[i % 8]).length();
+        }));
+    printf("\n");
+  }
+  printf("prompt cache: %u hits / %u misses\n", (unsigned)gPromptCache.hits,
+         (unsigned)gPromptCache.misses);
+
+  // A patch round trip on a small pack: replace, add, delete by row and by
+  // title, a kept row with its own indentation (copied as stored) and a
+  // header value that needs its quotes back, against the pack it should
+  // produce; then the same patch on a stale base.
+  static const char kBase[] =
+      "name: patch\nversion: 1\nauthor: tester\n"
+      "description: \"\"quoted\" start\"\nthreshold: 2\ntemperature: 0.5\n"
+      "entries[4]{t,k,a}:\n"
+      "  \"Alpha\",\"alpha:2\",\"First.\"\n"
+      "    \"Beta\",\"beta:2 b:1\",\"Second, \"\"kept\"\" as stored.\"\n"
+      "  \"Gamma\",\"gamma:2\",\"Third.\"\n"
+      "  \"Delta\",\"delta:2\",\"Fourth.\"\n";
+  static const char kPatch[] =
+      "base: %08x\nversion: 2\ndelete[2]: #2,\"Delta\"\n"
+      "entries[2]{t,k,a}:\n"
+      "  \"Alpha\",\"alpha:2 first:1\",\"First, replaced.\"\n"
+      "  \"Epsilon\",\"epsilon:2\",\"Added.\"\n";
+  static const char kWant[] =
+      "name: patch\nversion: 2\nauthor: tester\n"
+      "description: \"\"quoted\" start\"\nthreshold: 2\ntemperature: 0.5\n"
+      "entries[3]{t,k,a}:\n"
+      "  \"Alpha\",\"alpha:2 first:1\",\"First, replaced.\"\n"
+      "    \"Beta\",\"beta:2 b:1\",\"Second, \"\"kept\"\" as stored.\"\n"
+      "  \"Epsilon\",\"epsilon:2\",\"Added.\"\n";
+  printf("\npatch      check                                    result\n");
+  auto check = [](const String &what, const String &res) {
+    printf("           %-40s %s\n", what.c_str(), res.c_str());
+  };
+  writePack(MODEL_PATH, (const uint8_t *)kBase, sizeof(kBase) - 1);
+  loadModels();
+  PackFile base;
+  base.open((const uint8_t *)kBase, sizeof(kBase) - 1);
+  uint32_t baseHash = hashPack(base);
+  for (uint32_t h : {baseHash, baseHash ^ 1}) {
+    char text[sizeof(kPatch) + 8];
+    int n = snprintf(text, sizeof(text), kPatch, (unsigned)h);
+    PackFile src;
+    src.open((const uint8_t *)text, n);
+    PatchStats st;
+    String msg;
+    int code = patchPack(src, MODEL_PATH, "/patched.toon", st, msg);
+    if (h != baseHash) {
+      check("stale base", String(code));
+      continue;
+    }
+    check(String(st.replaced) + " replaced, " + st.added + " added, " +
+              st.deleted + " deleted",
+          String(code));
+    PackFile out;
+    std::string got;
+    if (out.open("/patched.toon")) {
+      got.resize(out.size);
+      got.resize(out.read((uint8_t *)&got[0], got.size()));
+    }
+    out.close();
+    check("matches the expected pack", got == kWant ? "yes" : "NO");
+  }
+  LittleFS.remove("/patched.toon");
+
+  // The wasm host API against the simulated pins and I2C device: what a
+  // driver pays per call, refusals included, and a six-byte register read
+  // as six crossings vs one burst.
+  printf("\nhost API   call                          ns/call  result\n");
+  for (int i = 0; i < 256; i++) hostI2cRegs[i] = i * 37;
+  volatile int32_t res = 0;
+  uint8_t reg = 0xF7, one[6], burst[6];
+  auto api = [&](const char *call, int count, std::function<int32_t(int)> fn) {
+    double ns = timeEach(count, [&](int i) { res = fn(i); }).ns;
+    printf("           %-28s %8.0f  %d\n", call, ns, (int)res);
+  };
+  api("gpio_write(5, 1)", kQueries, [](int) { return hostGpioWrite(5, 1); });
+  api("gpio_write(0, 1) unsafe pin", kQueries,
+      [](int) { return hostGpioWrite(0, 1); });
+  api("gpio_read(5)", kQueries, [](int) { return hostGpioRead(5); });
+  api("adc_read(4)", kQueries, [](int) { return hostAdcRead(4); });
+  api("adc_read(3) unsafe pin", kQueries, [](int) { return hostAdcRead(3); });
+  api("i2c 6 x 1-byte reads", kQueries, [&](int) {
+    int32_t got = 0;
+    for (int k = 0; k < 6; k++) {
+      uint8_t r = reg + k;
+      got += hostI2cWriteRead(HOST_I2C_DEV, &r, 1, one + k, 1);
+    }
+    return got;
+  });
+  api("i2c_write_read 6-byte burst", kQueries, [&](int) {
+    return hostI2cWriteRead(HOST_I2C_DEV, &reg, 1, burst, 6);
+  });
+  api("i2c_write_read absent 0x40", kQueries,
+      [&](int) { return hostI2cWriteRead(0x40, &reg, 1, burst, 6); });
+  printf("           burst matches single reads: %s\n",
+         memcmp(one, burst, 6) ? "NO" : "yes");
+  uint8_t block[8];
+  api("adc_read_block 2 s span", 1,
+      [&](int) { return hostAdcReadBlock(4, block, 4, 500000); });
+  gWasmDeadline = esp_timer_get_time() - 1;  // a spent time budget
+  api("delay_us(10) past deadline", kQueries,
+      [](int) { return hostDelayUs(10); });
+  api("adc_read_block past deadline", kQueries,
+      [&](int) { return hostAdcReadBlock(4, block, 4, 10); });
+  gWasmDeadline = 0;
+
+#ifdef AURA_WASM3
+  // The on-chip `bench wasm` kernels under the same wasm3, for a
+  // chip-vs-host ratio per kernel.
+  printf("\n%s", cmdBenchWasm().c_str());
+#endif
+
+  modelsPublish(new ModelSet());
+  LittleFS.remove(MODEL_PATH);
+  rmdir(root);
+  return 0;
+}
@@ -0,0 +1,148 @@
+// Host stand-ins: chip services, a directory-backed LittleFS, simulated
+// pins and I2C bus, and the allocation hooks that feed AURA's gAllocs
+// counter.
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <Wire.h>
+#include <chrono>
+#include <new>
+#include <string>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+bool hostSerialEcho = false;
+HostSerial Serial;
+HostEsp ESP;
+HostFS LittleFS;
+TwoWire Wire;
+const char *hostFsRoot = ".";
+
+// ------------------------------------------------------------ time ----------
+
+static const std::chrono::steady_clock::time_point kStart =
+    std::chrono::steady_clock::now();
+
+int64_t esp_timer_get_time() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now() - kStart)
+      .count();
+}
+unsigned long millis() { return esp_timer_get_time() / 1000; }
+void delay(unsigned long ms) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+static uint32_t gRng = 1;
+void hostSeed(uint32_t seed) { gRng = seed ? seed : 1; }
+uint32_t esp_random() {
+  gRng ^= gRng << 13;
+  gRng ^= gRng >> 17;
+  gRng ^= gRng << 5;
+  return gRng;
+}
+
+// ------------------------------------------------------------ pins ----------
+
+static uint8_t gLevel[64];
+void pinMode(uint8_t, uint8_t) {}
+void digitalWrite(uint8_t pin, uint8_t level) { gLevel[pin & 63] = level; }
+int digitalRead(uint8_t pin) { return gLevel[pin & 63]; }
+uint16_t analogRead(uint8_t) { return 0; }
+uint32_t analogReadMilliVolts(uint8_t) { return 0; }
+void analogWrite(uint8_t pin, int duty) { gLevel[pin & 63] = duty > 0; }
+float temperatureRead() { return 36.5f; }
+
+// ------------------------------------------------------------- i2c ----------
+
+uint8_t hostI2cRegs[256];
+
+void TwoWire::beginTransmission(uint8_t addr) {
+  addr_ = addr;
+  n_ = 0;
+}
+size_t TwoWire::write(const uint8_t *p, size_t n) {
+  for (size_t i = 0; i < n && n_ < sizeof(buf_); i++) buf_[n_++] = p[i];
+  return n;
+}
+uint8_t TwoWire::endTransmission(bool) {
+  if (addr_ != HOST_I2C_DEV) return 2;  // address NACK
+  if (n_) reg_ = buf_[0];
+  for (size_t i = 1; i < n_; i++) hostI2cRegs[reg_++] = buf_[i];
+  return 0;
+}
+size_t TwoWire::requestFrom(uint16_t addr, size_t n, bool) {
+  n_ = at_ = 0;
+  if (addr != HOST_I2C_DEV) return 0;
+  for (; n_ < n && n_ < sizeof(buf_); n_++) buf_[n_] = hostI2cRegs[reg_++];
+  return n_;
+}
+int TwoWire::read() { return at_ < n_ ? buf_[at_++] : -1; }
+
+// -------------------------------------------------------------- fs ----------
+
+static std::string hostPath(const char *path) {
+  return std::string(hostFsRoot) + path;
+}
+
+File HostFS::open(const char *path, const char *mode) {
+  const char *m = mode[0] == 'w' ? "wb" : mode[0] == 'a' ? "ab" : "rb";
+  struct stat st;
+  if (mode[0] == 'r' && stat(hostPath(path).c_str(), &st) == 0 &&
+      S_ISDIR(st.st_mode))
+    return File(opendir(hostPath(path).c_str()), path);
+  return File(fopen(hostPath(path).c_str(), m), path);
+}
+File File::openNextFile() {
+  for (struct dirent *e; dir_ && (e = readdir(dir_));) {
+    if (e->d_name[0] == '.') continue;
+    return LittleFS.open((path_ + "/" + e->d_name).c_str());
+  }
+  return File();
+}
+bool HostFS::exists(const char *path) {
+  struct stat st;
+  return stat(hostPath(path).c_str(), &st) == 0;
+}
+bool HostFS::remove(const char *path) {
+  return unlink(hostPath(path).c_str()) == 0;
+}
+
+// ------------------------------------------------------- allocations --------
+// Linked with -Wl,--wrap=malloc,--wrap=realloc,--wrap=calloc: every heap
+// allocation the engine and the stand-ins make calls the same hook the
+// ESP-IDF heap does with CONFIG_HEAP_USE_HOOKS.
+
+extern "C" {
+void *__real_malloc(size_t);
+void *__real_realloc(void *, size_t);
+void *__real_calloc(size_t, size_t);
+void esp_heap_trace_alloc_hook(void *, size_t, uint32_t);
+
+void *__wrap_malloc(size_t n) {
+  void *p = __real_malloc(n);
+  esp_heap_trace_alloc_hook(p, n, 0);
+  return p;
+}
+void *__wrap_realloc(void *old, size_t n) {
+  void *p = __real_realloc(old, n);
+  if (n) esp_heap_trace_alloc_hook(p, n, 0);
+  return p;
+}
+void *__wrap_calloc(size_t k, size_t n) {
+  void *p = __real_calloc(k, n);
+  esp_heap_trace_alloc_hook(p, k * n, 0);
+  return p;
+}
+}
+
+void *operator new(size_t n) {
+  void *p = malloc(n ? n : 1);
+  if (!p) throw std::bad_alloc();
+  return p;
+}
+void *operator new[](size_t n) { return operator new(n); }
+void operator delete(void *p) noexcept { free(p); }
+void operator delete[](void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+void operator delete[](void *p, size_t) noexcept { free(p); }
@@ -0,0 +1,251 @@
+// Host stand-in for the parts of the Arduino-ESP32 core AURA's engine uses.
+// Only what src/AURA.cpp needs under AURA_HOST; behaviour follows the
+// ESP32 core where it matters to benchmarks (String allocates like the
+// core's: a small inline buffer, then malloc/realloc).
+#pragma once
+#include <cctype>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#define PROGMEM
+#define FPSTR(p) (p)
+#define SET_LOOP_TASK_STACK_SIZE(n)
+#define HIGH 1
+#define LOW 0
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define SDA 8
+#define SCL 9
+
+// ------------------------------------------------------------ String --------
+
+class String {
+ public:
+  String() { init(); }
+  String(const char *s) { init(); copy(s, s ? strlen(s) : 0); }
+  String(const String &o) { init(); copy(o.c_str(), o.len_); }
+  String(String &&o) { init(); move(o); }
+  explicit String(char c) { init(); copy(&c, 1); }
+  explicit String(int v) { init(); fmt("%d", v); }
+  explicit String(unsigned v) { init(); fmt("%u", v); }
+  explicit String(long v) { init(); fmt("%ld", v); }
+  explicit String(unsigned long v) { init(); fmt("%lu", v); }
+  explicit String(float v, unsigned dec = 2) { init(); fmt("%.*f", (int)dec, v); }
+  explicit String(double v, unsigned dec = 2) { init(); fmt("%.*f", (int)dec, v); }
+  ~String() { free(heap_); }
+
+  String &operator=(const String &o) {
+    if (this != &o) copy(o.c_str(), o.len_);
+    return *this;
+  }
+  String &operator=(String &&o) {
+    if (this != &o) move(o);
+    return *this;
+  }
+  String &operator=(const char *s) { return copy(s, s ? strlen(s) : 0); }
+
+  unsigned length() const { return len_; }
+  const char *c_str() const { return heap_ ? heap_ : sso_; }
+  char operator[](unsigned i) const { return i < len_ ? c_str()[i] : 0; }
+  bool reserve(unsigned n) { return grow(n); }
+
+  bool concat(const char *s, unsigned n) {
+    if (!grow(len_ + n)) return false;
+    memcpy(buf() + len_, s, n);
+    len_ += n;
+    buf()[len_] = 0;
+    return true;
+  }
+  String &operator+=(const String &o) { concat(o.c_str(), o.len_); return *this; }
+  String &operator+=(const char *s) { concat(s, strlen(s)); return *this; }
+  String &operator+=(char c) { concat(&c, 1); return *this; }
+  String &operator+=(int v) { return *this += String(v); }
+  String &operator+=(unsigned v) { return *this += String(v); }
+  String &operator+=(long v) { return *this += String(v); }
+  String &operator+=(unsigned long v) { return *this += String(v); }
+
+  bool operator==(const String &o) const {
+    return len_ == o.len_ && !memcmp(c_str(), o.c_str(), len_);
+  }
+  bool operator==(const char *s) const { return !strcmp(c_str(), s); }
+  bool operator!=(const String &o) const { return !(*this == o); }
+  bool operator!=(const char *s) const { return !(*this == s); }
+  bool operator<(const String &o) const { return strcmp(c_str(), o.c_str()) < 0; }
+
+  bool startsWith(const String &p) const {
+    return p.len_ <= len_ && !memcmp(c_str(), p.c_str(), p.len_);
+  }
+  bool endsWith(const String &p) const {
+    return p.len_ <= len_ && !memcmp(c_str() + len_ - p.len_, p.c_str(), p.len_);
+  }
+  int indexOf(char c, unsigned from = 0) const {
+    const char *p = from < len_ ? strchr(c_str() + from, c) : nullptr;
+    return p ? p - c_str() : -1;
+  }
+  int indexOf(const String &s, unsigned from = 0) const {
+    const char *p = from <= len_ ? strstr(c_str() + from, s.c_str()) : nullptr;
+    return p ? p - c_str() : -1;
+  }
+  int lastIndexOf(char c) const {
+    const char *p = strrchr(c_str(), c);
+    return p ? p - c_str() : -1;
+  }
+  String substring(unsigned from) const { return substring(from, len_); }
+  String substring(unsigned from, unsigned to) const {
+    String r;
+    if (from > to) { unsigned t = from; from = to; to = t; }
+    if (to > len_) to = len_;
+    if (from < to) r.concat(c_str() + from, to - from);
+    return r;
+  }
+  void trim() {
+    const char *s = c_str();
+    unsigned b = 0, e = len_;
+    while (b < e && isspace((unsigned char)s[b])) b++;
+    while (e > b && isspace((unsigned char)s[e - 1])) e--;
+    memmove(buf(), s + b, e - b);
+    len_ = e - b;
+    buf()[len_] = 0;
+  }
+  void toLowerCase() {
+    for (unsigned i = 0; i < len_; i++) buf()[i] = tolower((unsigned char)buf()[i]);
+  }
+  void replace(const String &from, const String &to) {
+    if (!from.len_) return;
+    String out;
+    const char *s = c_str(), *hit;
+    while ((hit = strstr(s, from.c_str()))) {
+      out.concat(s, hit - s);
+      out += to;
+      s = hit + from.len_;
+    }
+    out += s;
+    *this = static_cast<String &&>(out);
+  }
+  void remove(unsigned at, unsigned n = (unsigned)-1) {
+    if (at >= len_) return;
+    if (n > len_ - at) n = len_ - at;
+    memmove(buf() + at, buf() + at + n, len_ - at - n + 1);
+    len_ -= n;
+  }
+  long toInt() const { return atol(c_str()); }
+  float toFloat() const { return atof(c_str()); }
+
+ private:
+  static const unsigned SSO = 11;  // the ESP32 core's inline capacity
+  char sso_[SSO + 1];
+  char *heap_;
+  unsigned len_, cap_;
+
+  void init() {
+    heap_ = nullptr;
+    len_ = 0;
+    cap_ = SSO;
+    sso_[0] = 0;
+  }
+  char *buf() { return heap_ ? heap_ : sso_; }
+  bool grow(unsigned n) {
+    if (n <= cap_) return true;
+    char *p = (char *)realloc(heap_, n + 1);
+    if (!p) return false;
+    if (!heap_) memcpy(p, sso_, len_ + 1);
+    heap_ = p;
+    cap_ = n;
+    return true;
+  }
+  String &copy(const char *s, unsigned n) {
+    len_ = 0;
+    if (grow(n)) {
+      memmove(buf(), s, n);
+      len_ = n;
+    }
+    buf()[len_] = 0;
+    return *this;
+  }
+  void move(String &o) {
+    free(heap_);
+    memcpy(sso_, o.sso_, sizeof(sso_));
+    heap_ = o.heap_;
+    len_ = o.len_;
+    cap_ = o.cap_;
+    o.init();
+  }
+  void fmt(const char *f, ...) {
+    char b[64];
+    va_list ap;
+    va_start(ap, f);
+    int n = vsnprintf(b, sizeof(b), f, ap);
+    va_end(ap);
+    copy(b, n < (int)sizeof(b) ? n : sizeof(b) - 1);
+  }
+};
+
+template <typename T>
+inline String operator+(const String &a, const T &b) {
+  String r(a);
+  r += b;
+  return r;
+}
+inline String operator+(const String &a, float b) { return a + String(b); }
+inline String operator+(const String &a, double b) { return a + String(b); }
+inline String operator+(const char *a, const String &b) { return String(a) + b; }
+
+// ------------------------------------------------------------- Print --------
+
+class Print {
+ public:
+  virtual ~Print() {}
+  virtual size_t write(const uint8_t *b, size_t n) = 0;
+  size_t print(const char *s) { return write((const uint8_t *)s, strlen(s)); }
+  size_t print(const String &s) { return print(s.c_str()); }
+  size_t println(const char *s = "") { return print(s) + print("\n"); }
+  size_t println(const String &s) { return println(s.c_str()); }
+  size_t printf(const char *f, ...) __attribute__((format(printf, 2, 3))) {
+    char b[1024];
+    va_list ap;
+    va_start(ap, f);
+    int n = vsnprintf(b, sizeof(b), f, ap);
+    va_end(ap);
+    return write((const uint8_t *)b, n < (int)sizeof(b) ? n : sizeof(b) - 1);
+  }
+};
+
+// Serial goes to stderr when hostSerialEcho is set; benches keep it off.
+extern bool hostSerialEcho;
+class HostSerial : public Print {
+ public:
+  void begin(unsigned long) {}
+  size_t write(const uint8_t *b, size_t n) override {
+    return hostSerialEcho ? fwrite(b, 1, n, stderr) : n;
+  }
+};
+extern HostSerial Serial;
+
+// ----------------------------------------------------------- chip -----------
+
+unsigned long millis();
+int64_t esp_timer_get_time();
+void delay(unsigned long ms);
+uint32_t esp_random();  // xorshift32, seeded by hostSeed()
+void hostSeed(uint32_t seed);
+
+// Simulated pins: levels written are read back; analog reads are 0.
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t level);
+int digitalRead(uint8_t pin);
+uint16_t analogRead(uint8_t pin);
+uint32_t analogReadMilliVolts(uint8_t pin);
+void analogWrite(uint8_t pin, int duty);
+float temperatureRead();
+
+struct HostEsp {
+  uint32_t getFreeHeap() { return 64u << 20; }
+};
+extern HostEsp ESP;
+
+inline bool psramFound() { return false; }
+inline void *ps_malloc(size_t n) { return malloc(n); }
+inline void *ps_realloc(void *p, size_t n) { return realloc(p, n); }
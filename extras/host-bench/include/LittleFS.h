@@ -0,0 +1,79 @@
+// Host stand-in for LittleFS: paths live under hostFsRoot on the host.
+#pragma once
+#include <Arduino.h>
+#include <dirent.h>
+#include <string>
+
+class File : public Print {
+ public:
+  File(FILE *f = nullptr, const std::string &path = "") : f_(f), path_(path) {}
+  File(DIR *d, const std::string &path) : f_(nullptr), dir_(d), path_(path) {}
+  File(const File &) = delete;
+  File(File &&o) : f_(o.f_), dir_(o.dir_), path_(o.path_) {
+    o.f_ = nullptr;
+    o.dir_ = nullptr;
+  }
+  File &operator=(File &&o) {
+    close();
+    f_ = o.f_;
+    dir_ = o.dir_;
+    path_ = o.path_;
+    o.f_ = nullptr;
+    o.dir_ = nullptr;
+    return *this;
+  }
+  ~File() { close(); }
+  explicit operator bool() const { return f_ || dir_; }
+
+  const char *name() const {
+    size_t at = path_.rfind('/');
+    return path_.c_str() + (at == std::string::npos ? 0 : at + 1);
+  }
+  bool isDirectory() const { return dir_ != nullptr; }
+  File openNextFile();
+
+  size_t read(uint8_t *b, size_t n) { return f_ ? fread(b, 1, n, f_) : 0; }
+  size_t write(const uint8_t *b, size_t n) override {
+    return f_ ? fwrite(b, 1, n, f_) : 0;
+  }
+  bool seek(uint32_t pos) { return f_ && fseek(f_, pos, SEEK_SET) == 0; }
+  size_t size() {
+    if (!f_) return 0;
+    long at = ftell(f_);
+    fseek(f_, 0, SEEK_END);
+    long n = ftell(f_);
+    fseek(f_, at, SEEK_SET);
+    return n;
+  }
+  String readString() {
+    String s;
+    char b[256];
+    size_t n;
+    while ((n = read((uint8_t *)b, sizeof(b))) > 0) s.concat(b, n);
+    return s;
+  }
+  void close() {
+    if (f_) fclose(f_);
+    if (dir_) closedir(dir_);
+    f_ = nullptr;
+    dir_ = nullptr;
+  }
+
+ private:
+  FILE *f_;
+  DIR *dir_ = nullptr;
+  std::string path_;  // as opened, relative to hostFsRoot
+};
+
+extern const char *hostFsRoot;
+
+class HostFS {
+ public:
+  bool begin(bool = false) { return true; }
+  File open(const char *path, const char *mode = "r");
+  bool exists(const char *path);
+  bool remove(const char *path);
+  size_t usedBytes() { return 0; }
+  size_t totalBytes() { return 0; }
+};
+extern HostFS LittleFS;
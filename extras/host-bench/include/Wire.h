@@ -0,0 +1,27 @@
+// Host stand-in for the I2C bus: one simulated register-file device at
+// HOST_I2C_DEV answers, every other address NACKs. A write's first byte
+// sets the register pointer and the rest are stored from there; reads
+// continue from the pointer, as most sensor chips do.
+#pragma once
+#include <Arduino.h>
+
+#define HOST_I2C_DEV 0x76  // a BMP280's address
+extern uint8_t hostI2cRegs[256];
+
+class TwoWire {
+ public:
+  bool begin() { return true; }
+  bool begin(int, int) { return true; }
+  void end() {}
+  void beginTransmission(uint8_t addr);
+  size_t write(const uint8_t *p, size_t n);
+  uint8_t endTransmission(bool stop = true);
+  size_t requestFrom(uint16_t addr, size_t n, bool stop = true);
+  int read();
+
+ private:
+  uint8_t addr_ = 0, reg_ = 0;
+  uint8_t buf_[256];
+  size_t n_ = 0, at_ = 0;
+};
+extern TwoWire Wire;
@@ -0,0 +1,37 @@
+// Host stand-in for the partition API: there is no aura_model partition,
+// so compiled models always go to heap.
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_FAIL -1
+
+typedef enum { ESP_PARTITION_TYPE_DATA = 1 } esp_partition_type_t;
+typedef enum { ESP_PARTITION_SUBTYPE_ANY = 0xff } esp_partition_subtype_t;
+typedef struct {
+  uint32_t size;
+} esp_partition_t;
+typedef uint32_t esp_partition_mmap_handle_t;
+typedef enum { ESP_PARTITION_MMAP_DATA } esp_partition_mmap_memory_t;
+
+inline const esp_partition_t *esp_partition_find_first(
+    esp_partition_type_t, esp_partition_subtype_t, const char *) {
+  return nullptr;
+}
+inline esp_err_t esp_partition_erase_range(const esp_partition_t *, size_t,
+                                           size_t) {
+  return ESP_FAIL;
+}
+inline esp_err_t esp_partition_write(const esp_partition_t *, size_t,
+                                     const void *, size_t) {
+  return ESP_FAIL;
+}
+inline esp_err_t esp_partition_mmap(const esp_partition_t *, size_t, size_t,
+                                    esp_partition_mmap_memory_t,
+                                    const void **,
+                                    esp_partition_mmap_handle_t *) {
+  return ESP_FAIL;
+}
+inline void esp_partition_munmap(esp_partition_mmap_handle_t) {}
@@ -3,32 +3,97 @@
 
 #include "AURA.h"
 
+// AURA_HOST: the engine (TOON parsing, scoring, prompts, benches) built for
+// Linux against the stand-ins in extras/host-bench. Network, wasm and the
+// web UI stay on the chip; AURA_WASM3 (host builds linked with wasm3) adds
+// back the `bench wasm` kernels.
+#ifndef AURA_HOST
 #include <WiFi.h>
 #include <WebServer.h>
 #include <ESPmDNS.h>
-#include <LittleFS.h>
 #include <HTTPClient.h>
 #include <WiFiClientSecure.h>
+#endif
+#if !defined(AURA_HOST) || defined(AURA_WASM3)
+#include <wasm3.h>
+#endif
+#include <LittleFS.h>
 #include <Wire.h>
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <mutex>
 #include <vector>
-#include <wasm3.h>
+#include <esp_partition.h>
+#include <esp_idf_version.h>
+
+#if ESP_IDF_VERSION_MAJOR >= 5
+typedef esp_partition_mmap_handle_t ImgMapHandle;
+#define IMG_MMAP_DATA ESP_PARTITION_MMAP_DATA
+#define imgMunmap esp_partition_munmap
+#else
+typedef spi_flash_mmap_handle_t ImgMapHandle;
+#define IMG_MMAP_DATA SPI_FLASH_MMAP_DATA
+#define imgMunmap spi_flash_munmap
+#endif
+#ifndef AURA_HOST
+#if ESP_IDF_VERSION_MAJOR >= 5
+#include <esp_memory_utils.h>  // esp_ptr_external_ram
+#include <esp_app_desc.h>
+#define appDescription esp_app_get_description
+#else
+#include <soc/soc_memory_layout.h>
+#include <esp_ota_ops.h>
+#define appDescription esp_ota_get_app_description
+#endif
+#endif
 
 static const char *MODEL_PATH = "/model.toon";
-static const size_t MAX_UPLOAD_SIZE = 96 * 1024;
+static const char *MODELS_DIR = "/models";  // more packs, loaded alongside
+static const char *MODEL_RETIRED_DIR = "/retired";  // replaced, still read
+static const char *MODEL_PARTITION = "aura_model";  // optional data partition
+static const size_t BENCH_PACK_SIZE = 96 * 1024;  // `bench parse` pack
+static const size_t MAX_TOON_LINE = 2048;  // longest TOON line, without \n
+static const uint32_t DECLINE_TOPICS = 8;  // titles a decline suggests
 static const uint32_t WASM_STACK_BYTES = 16 * 1024;
+static const uint32_t WASM_LIMIT_MS = 10000;  // default per-call budget
 
 // wasm3 + TLS need more native stack than the 8 KB Arduino default
 SET_LOOP_TASK_STACK_SIZE(32 * 1024);
 
 static AuraClass::Config gCfg;
+#ifndef AURA_HOST
 static WebServer server(80);
-
-static std::vector<uint8_t> uploadBuf;
-static bool uploadTooBig = false;
+static const char *MODEL_NEXT_PATH = "/model.next";  // install in progress
+static const char *MODEL_FETCH_PATH = "/model.fetch";  // background fetch
+static const char *MODEL_UPLOAD_PATH = "/model.upload";  // upload arriving
+static const char *WASM_UPLOAD_PATH = "/upload.wasm";
+static const char *WASM_DIR = "/wasm";  // installed modules, <name>.wasm
+static const char *WASM_HOT_PATH = "/wasm/hot.txt";  // preload, MRU first
+static const char *WASM_SCHED_PATH = "/wasm/sched.txt";  // periodic calls
+static const int WASM_HOT = 4;
+static const char *SELFTEST_PATH = "/selftest.txt";  // cached boot checks
+static std::mutex gInstallLock;  // one install or patch at a time
+#endif
+// The prompt path shares scratch buffers, the prompt cache and the lazy
+// answer LRU: one prompt at a time, whichever task asks.
+static std::mutex gPromptLock;
 
 AuraClass AURA;
 
+static uint32_t fnv1a(uint32_t h, const uint8_t *p, size_t n) {
+  while (n--) h = (h ^ *p++) * 16777619u;
+  return h;
+}
+static const uint32_t FNV_SEED = 2166136261u;
+
 // ---------------------------------------------------------------- wasm ------
+// The running call's wall-time deadline (esp_timer µs, 0 = none). Host API
+// calls that wait honour it too, so it lives outside the wasm3 guard. Each
+// task that runs wasm has its own (see m3_Yield).
+static thread_local int64_t gWasmDeadline = 0;
+
+#ifndef AURA_HOST
 
 // (module (func (export "fib") (param i32) (result i32) ...)) — classic
 // recursive fib, hand-checked wasm binary, 62 bytes.
@@ -43,108 +108,1029 @@ static const uint8_t FIB_WASM[] = {
     0x20, 0x00, 0x41, 0x01, 0x6b, 0x10, 0x00,
     0x6a, 0x0f, 0x0b};
 
+// Warm runtimes. A module stays parsed and loaded in one of WASM_SLOTS
+// runtimes keyed by a hash of its bytes, so a repeat call goes straight to
+// m3_FindFunction. wasm3 keeps pointers into the module bytes, so a slot
+// owns them. Least recently used slots are freed while the cached total —
+// bytes, a compiled-code estimate, stack and linear memory — is over
+// wasmBudget(). Globals and linear memory persist between warm calls; a
+// trap drops the slot.
+static const int WASM_SLOTS = 6;
+
+struct WasmSlot {
+  uint32_t hash = 0, used = 0, calls = 0;  // used: LRU tick, 0 = empty
+  size_t len = 0, cost = 0;
+  uint8_t *bytes = nullptr;
+  IM3Runtime rt = nullptr;
+  int64_t setupUs = 0, lastUs = 0;  // parse + load, latest call
+};
+
+struct WasmCache {
+  IM3Environment env = nullptr;  // shared by every slot, never freed
+  WasmSlot slot[WASM_SLOTS];
+  uint32_t tick = 0, hits = 0, misses = 0;
+};
+static WasmCache gWasm;
+// One call at a time in gWasm — prompts, jobs and HTTP. The scheduler runs
+// its modules in an environment of its own and never takes it.
+static std::mutex gWasmLock;
+
+// Imports from "aura" (the host API), linked into every module on load.
+static M3Result wasmLinkHost(IM3Module module);
+
+// A call's limits going in and how it went coming out: setupUs is parse +
+// load, 0 when a warm runtime ran it. Past either limit the call unwinds
+// with a "budget exceeded" trap.
+struct WasmCall {
+  uint32_t limitMs = WASM_LIMIT_MS;  // wall time, 0 = none
+  uint32_t limitSteps = 0;  // loop iterations + calls, 0 = none
+  int64_t us = 0, setupUs = 0;
+  bool warm = false;
+  bool ok = false;  // it ran and returned, rather than an error
+};
+
+// wasm3 calls the weak m3_Yield() on every loop iteration and function
+// call; an error from it unwinds the running call like a trap. It gets no
+// context, and the gWasm worker and the scheduler may both be mid-call, so
+// the budget is per task.
+static thread_local uint32_t gWasmSteps = 0, gWasmStepLimit = 0;
+
+extern "C" M3Result m3_Yield() {
+  ++gWasmSteps;
+  if (gWasmStepLimit && gWasmSteps > gWasmStepLimit)
+    return "step budget exceeded";
+  if (gWasmDeadline && !(gWasmSteps & 255) &&
+      esp_timer_get_time() > gWasmDeadline)
+    return "time budget exceeded";
+  return m3Err_none;
+}
+
+static size_t wasmBudget() {
+  return psramFound() ? 1024 * 1024 : 128 * 1024;
+}
+
+static size_t wasmCached() {
+  size_t n = 0;
+  for (auto &s : gWasm.slot)
+    if (s.used) n += s.cost;
+  return n;
+}
+
+// A runtime in env with bytes parsed, loaded and linked to the host API;
+// null and err on failure. bytes must outlive the runtime.
+static IM3Runtime wasmLoad(IM3Environment env, const uint8_t *bytes,
+                           size_t len, String &err) {
+  IM3Runtime rt = m3_NewRuntime(env, WASM_STACK_BYTES, NULL);
+  IM3Module module = NULL;
+  M3Result res = NULL;
+  if (!rt) {
+    err = "error: no memory for wasm runtime";
+    return NULL;
+  }
+  if ((res = m3_ParseModule(env, &module, bytes, len))) {
+    err = String("wasm parse error: ") + res;
+  } else if ((res = m3_LoadModule(rt, module))) {
+    err = String("wasm load error: ") + res;
+    m3_FreeModule(module);
+  } else if ((res = wasmLinkHost(module))) {
+    err = String("wasm link error: ") + res;
+  }
+  if (!res) return rt;
+  m3_FreeRuntime(rt);
+  return NULL;
+}
+
+static void wasmDrop(WasmSlot &s) {
+  if (s.rt) m3_FreeRuntime(s.rt);  // frees the module loaded into it
+  free(s.bytes);
+  s = WasmSlot();
+}
+
+// The slot running bytes, loading them on a miss. Takes ownership of
+// bytes when owned (a malloc'd buffer); otherwise copies them if needed.
+static WasmSlot *wasmSlot(const uint8_t *bytes, size_t len, bool owned,
+                          WasmCall &call, String &err) {
+  uint32_t hash = fnv1a(FNV_SEED, bytes, len);
+  for (auto &s : gWasm.slot)
+    if (s.used && s.hash == hash && s.len == len &&
+        !memcmp(s.bytes, bytes, len)) {
+      if (owned) free((void *)bytes);
+      s.used = ++gWasm.tick;
+      gWasm.hits++;
+      call.warm = true;
+      return &s;
+    }
+  gWasm.misses++;
+  uint8_t *own = owned ? (uint8_t *)bytes : (uint8_t *)malloc(len);
+  if (!own) {
+    err = "error: no memory for the wasm module";
+    return nullptr;
+  }
+  if (!owned) memcpy(own, bytes, len);
+
+  int64_t t0 = esp_timer_get_time();
+  if (!gWasm.env) gWasm.env = m3_NewEnvironment();
+  IM3Runtime rt = gWasm.env ? wasmLoad(gWasm.env, own, len, err) : NULL;
+  if (!rt) {
+    if (!gWasm.env) err = "error: no memory for wasm environment";
+    free(own);
+    return nullptr;
+  }
+  call.setupUs = esp_timer_get_time() - t0;
+
+  size_t cost = len * 3 + WASM_STACK_BYTES + m3_GetMemorySize(rt);
+  WasmSlot *s = &gWasm.slot[0];
+  for (auto &c : gWasm.slot)
+    if (c.used < s->used) s = &c;
+  if (s->used) wasmDrop(*s);
+  while (wasmCached() + cost > wasmBudget()) {
+    WasmSlot *old = nullptr;
+    for (auto &c : gWasm.slot)
+      if (c.used && (!old || c.used < old->used)) old = &c;
+    if (!old) break;  // alone over budget: run it, keep it until evicted
+    wasmDrop(*old);
+  }
+  s->hash = hash;
+  s->len = len;
+  s->cost = cost;
+  s->bytes = own;
+  s->rt = rt;
+  s->setupUs = call.setupUs;
+  s->used = ++gWasm.tick;
+  return s;
+}
+
+// "1.93 ms (warm)" or "1.93 ms + 4.10 ms cold setup"
+static String wasmTiming(const WasmCall &c) {
+  char buf[64];
+  if (c.warm)
+    snprintf(buf, sizeof(buf), "%.2f ms (warm)", c.us / 1000.0);
+  else
+    snprintf(buf, sizeof(buf), "%.2f ms + %.2f ms cold setup", c.us / 1000.0,
+             c.setupUs / 1000.0);
+  return buf;
+}
+
+// Arm the budgets in c for the call about to start; its start time.
+static int64_t wasmArm(const WasmCall &c) {
+  int64_t t0 = esp_timer_get_time();
+  gWasmSteps = 0;
+  gWasmStepLimit = c.limitSteps;
+  gWasmDeadline = c.limitMs ? t0 + c.limitMs * 1000LL : 0;
+  return t0;
+}
+
+static void wasmDisarm(WasmCall &c, int64_t t0) {
+  gWasmDeadline = 0;
+  gWasmStepLimit = 0;
+  c.us = esp_timer_get_time() - t0;
+}
+
+// The first result of a finished call, as text.
+static String wasmResultText(IM3Function f) {
+  if (m3_GetRetCount(f) == 0) return "(no return value)";
+  switch (m3_GetRetType(f, 0)) {
+    case c_m3Type_i32: {
+      int32_t v = 0;
+      m3_GetResultsV(f, &v);
+      return String(v);
+    }
+    case c_m3Type_i64: {
+      int64_t v = 0;
+      m3_GetResultsV(f, &v);
+      char b[24];
+      snprintf(b, sizeof(b), "%lld", (long long)v);
+      return b;
+    }
+    case c_m3Type_f32: {
+      float v = 0;
+      m3_GetResultsV(f, &v);
+      return String(v, 6);
+    }
+    case c_m3Type_f64: {
+      double v = 0;
+      m3_GetResultsV(f, &v);
+      return String(v, 6);
+    }
+    default:
+      return "(unsupported return type)";
+  }
+}
+
+// Call funcName(argv) in a loaded runtime under c's budgets; the result or
+// the error, as text. trapped: it started and failed, so the instance may
+// be half-updated and should not run again.
+static String wasmInvoke(IM3Runtime rt, const char *funcName, uint32_t argc,
+                         const char **argv, WasmCall &c, bool &trapped) {
+  IM3Function f;
+  M3Result res = m3_FindFunction(&f, rt, funcName);
+  if (res) return String("function '") + funcName + "' not found (" + res + ")";
+  uint32_t need = m3_GetArgCount(f);
+  if (need != argc)
+    return String("error: '") + funcName + "' expects " + need +
+           " argument(s), got " + argc;
+
+  int64_t t0 = wasmArm(c);
+  res = m3_CallArgv(f, argc, argv);
+  wasmDisarm(c, t0);
+  if (res) {
+    trapped = true;
+    return String("wasm runtime error: ") + res;
+  }
+  c.ok = true;
+  return wasmResultText(f);
+}
+
+// Call funcName(argv) in the module. owned: bytes is a malloc'd buffer the
+// cache takes over (kept in a slot or freed).
 static String runWasmModule(const uint8_t *bytes, size_t len,
                             const char *funcName,
                             uint32_t argc, const char **argv,
-                            int64_t *elapsedUs = nullptr) {
-  IM3Environment env = m3_NewEnvironment();
-  if (!env) return "error: no memory for wasm environment";
+                            WasmCall *call = nullptr, bool owned = false) {
+  std::lock_guard<std::mutex> g(gWasmLock);
+  WasmCall c;
+  if (call) {
+    c.limitMs = call->limitMs;
+    c.limitSteps = call->limitSteps;
+  }
+  String out;
+  WasmSlot *slot = wasmSlot(bytes, len, owned, c, out);
+  if (slot) {
+    bool trapped = false;
+    out = wasmInvoke(slot->rt, funcName, argc, argv, c, trapped);
+    if (c.ok || trapped) {
+      slot->calls++;
+      slot->lastUs = c.us;
+    }
+    if (trapped) wasmDrop(*slot);
+  }
+  if (call) *call = c;
+  return out;
+}
+
+// Byte-buffer ABI. The module exports its memory, alloc(len) -> ptr and
+// func(ptr, len). The input is copied once, to alloc's address in linear
+// memory. func returns either a plain number or an output buffer: an i64
+// with ptr in the low and len in the high 32 bits, or (multi-value) two
+// i32s ptr, len. The output goes to sink straight from linear memory,
+// before the next call can reuse it; a module may treat each alloc as a
+// fresh arena. Returns "" when output went to the sink, else the number or
+// an error.
+typedef std::function<void(const uint8_t *, size_t)> WasmSink;
 
+static String runWasmBytes(const uint8_t *bytes, size_t len,
+                           const char *funcName, const uint8_t *in,
+                           size_t inLen, const WasmSink &sink,
+                           WasmCall *call = nullptr, bool owned = false) {
+  std::lock_guard<std::mutex> g(gWasmLock);
+  WasmCall c;
+  if (call) {
+    c.limitMs = call->limitMs;
+    c.limitSteps = call->limitSteps;
+  }
   String out;
-  IM3Runtime runtime = m3_NewRuntime(env, WASM_STACK_BYTES, NULL);
-  IM3Module module = NULL;
+  WasmSlot *slot = wasmSlot(bytes, len, owned, c, out);
+  if (call) *call = c;
+  if (!slot) return out;
+  IM3Runtime runtime = slot->rt;
 
+  IM3Function alloc, f;
+  if (m3_FindFunction(&alloc, runtime, "alloc") ||
+      m3_GetArgCount(alloc) != 1 || m3_GetRetCount(alloc) != 1)
+    return "error: the module exports no alloc(len) -> ptr";
+  M3Result res = m3_FindFunction(&f, runtime, funcName);
+  if (res)
+    return String("function '") + funcName + "' not found (" + res + ")";
+  if (m3_GetArgCount(f) != 2)
+    return String("error: '") + funcName + "' must take (ptr, len)";
+
+  int64_t t0 = wasmArm(c);
+  uint32_t ptr = 0, memLen = 0;
+  uint64_t outAt = 0, outLen = 0;
+  bool buf = false;
   do {
-    if (!runtime) {
-      out = "error: no memory for wasm runtime";
-      break;
-    }
-    M3Result res = m3_ParseModule(env, &module, bytes, len);
-    if (res) {
-      out = String("wasm parse error: ") + res;
+    if ((res = m3_CallV(alloc, (int32_t)inLen))) break;
+    m3_GetResultsV(alloc, &ptr);
+    // alloc may grow memory, so look it up afterwards
+    uint8_t *mem = m3_GetMemory(runtime, &memLen, 0);
+    if (!mem || !ptr || (uint64_t)ptr + inLen > memLen) {
+      res = "alloc gave no room for the input";
       break;
     }
-    res = m3_LoadModule(runtime, module);
-    if (res) {
-      out = String("wasm load error: ") + res;
-      m3_FreeModule(module);
-      break;
+    memcpy(mem + ptr, in, inLen);
+    if ((res = m3_CallV(f, (int32_t)ptr, (int32_t)inLen))) break;
+    uint32_t nRet = m3_GetRetCount(f);
+    if (nRet == 2 && m3_GetRetType(f, 0) == c_m3Type_i32 &&
+        m3_GetRetType(f, 1) == c_m3Type_i32) {
+      uint32_t p = 0, n = 0;
+      m3_GetResultsV(f, &p, &n);
+      outAt = p;
+      outLen = n;
+      buf = true;
+    } else if (nRet == 1 && m3_GetRetType(f, 0) == c_m3Type_i64) {
+      uint64_t v = 0;
+      m3_GetResultsV(f, &v);
+      outAt = (uint32_t)v;
+      outLen = v >> 32;
+      buf = true;
     }
+  } while (0);
+  wasmDisarm(c, t0);
+  slot->calls++;
+  slot->lastUs = c.us;
+  if (call) call->us = c.us;
+  if (res) {
+    wasmDrop(*slot);
+    return String("wasm runtime error: ") + res;
+  }
+  uint8_t *mem = buf ? m3_GetMemory(runtime, &memLen, 0) : nullptr;
+  if (buf && (!mem || outAt + outLen > memLen))
+    return String("error: '") + funcName + "' returned a buffer outside memory";
+  if (call) call->ok = true;
+  if (!buf) return wasmResultText(f);
+  sink(mem + outAt, outLen);
+  return String();
+}
 
-    IM3Function f;
-    res = m3_FindFunction(&f, runtime, funcName);
-    if (res) {
-      out = String("function '") + funcName + "' not found (" + res + ")";
-      break;
+// Space- or comma-separated arguments into argv (pointing into toks).
+static uint32_t splitArgs(const String &s, String *toks, const char **argv,
+                          uint32_t max) {
+  uint32_t argc = 0;
+  int i = 0, len = s.length();
+  while (i < len && argc < max) {
+    while (i < len && (s[i] == ' ' || s[i] == ',')) i++;
+    int j = i;
+    while (j < len && s[j] != ' ' && s[j] != ',') j++;
+    if (j > i) {
+      toks[argc] = s.substring(i, j);
+      argv[argc] = toks[argc].c_str();
+      argc++;
     }
+    i = j;
+  }
+  return argc;
+}
 
-    uint32_t need = m3_GetArgCount(f);
-    if (need != argc) {
-      out = String("error: '") + funcName + "' expects " + need +
-            " argument(s), got " + argc;
-      break;
+// Output bytes for a reply: as they are when they read as text, else a
+// hex preview. Either way cut at WASM_SHOW_BYTES.
+static const size_t WASM_SHOW_BYTES = 512;
+
+static String wasmBytesText(const String &b) {
+  size_t n = b.length();
+  bool text = true;
+  for (size_t i = 0; i < n && text; i++) {
+    unsigned char ch = b[i];
+    text = ch >= 0x20 ? ch != 0x7f : ch == '\n' || ch == '\r' || ch == '\t';
+  }
+  String out;
+  if (text) {
+    out = n > WASM_SHOW_BYTES ? b.substring(0, WASM_SHOW_BYTES) + "…" : b;
+  } else {
+    char h[4];
+    for (size_t i = 0; i < n && i < 32; i++) {
+      snprintf(h, sizeof(h), "%02x", (unsigned char)b[i]);
+      out += h;
     }
+    if (n > 32) out += "…";
+  }
+  return out + " (" + (unsigned)n + " bytes)";
+}
 
-    int64_t t0 = esp_timer_get_time();
-    res = m3_CallArgv(f, argc, argv);
-    if (elapsedUs) *elapsedUs = esp_timer_get_time() - t0;
-    if (res) {
-      out = String("wasm runtime error: ") + res;
-      break;
+// Wasm jobs run on one worker task, pinned to core 0 so the loop task's
+// core keeps serving HTTP. A job is queued by id; the last WASM_JOBS stay
+// queryable. Prompts wait WASM_PROMPT_WAIT_MS for the answer and otherwise
+// hand back the id; HTTP returns the id at once.
+static const int WASM_JOBS = 8;
+static const uint32_t WASM_PROMPT_WAIT_MS = 250;
+
+enum WasmJobState : uint8_t { JOB_FREE, JOB_QUEUED, JOB_RUNNING, JOB_DONE };
+
+struct WasmJob {
+  int id = 0;
+  WasmJobState state = JOB_FREE;
+  const uint8_t *bytes = nullptr;
+  size_t len = 0;
+  bool owned = false;  // bytes is a malloc'd buffer for the runtime cache
+  String func, args, label;  // label: "fib(24)", "sieve.sieve(1000)"
+  bool feed = false;  // byte-buffer ABI: input in, output bytes back
+  String input, output;
+  WasmCall call;
+  String result;
+  uint32_t startedAt = 0;
+};
+static WasmJob gJobs[WASM_JOBS];
+static int gJobSeq = 0;
+static std::mutex gJobLock;  // guards gJobs; never held across a call
+static QueueHandle_t gJobQueue = nullptr;
+
+static void wasmWorker(void *) {
+  for (;;) {
+    int at;
+    if (xQueueReceive(gJobQueue, &at, portMAX_DELAY) != pdTRUE) continue;
+    WasmJob job;
+    String input;
+    {
+      std::lock_guard<std::mutex> g(gJobLock);
+      gJobs[at].state = JOB_RUNNING;
+      gJobs[at].startedAt = millis();
+      input = std::move(gJobs[at].input);
+      job = gJobs[at];
+    }
+    String r, output;
+    if (job.feed) {
+      r = runWasmBytes(job.bytes, job.len, job.func.c_str(),
+                       (const uint8_t *)input.c_str(), input.length(),
+                       [&](const uint8_t *p, size_t n) {
+                         output.concat((const char *)p, n);
+                       },
+                       &job.call, job.owned);
+      input = String();
+      if (!r.length()) r = wasmBytesText(output);
+    } else {
+      String toks[8];
+      const char *argv[8];
+      uint32_t argc = splitArgs(job.args, toks, argv, 8);
+      r = runWasmModule(job.bytes, job.len, job.func.c_str(), argc, argv,
+                        &job.call, job.owned);
     }
+    std::lock_guard<std::mutex> g(gJobLock);
+    WasmJob &done = gJobs[at];
+    done.call = job.call;
+    done.output = std::move(output);
+    done.result = "wasm3 » " + job.label + " = " + r +
+                  "\n(ran on-chip in " + wasmTiming(job.call) + ")";
+    done.bytes = nullptr;  // the runtime cache has them now
+    done.state = JOB_DONE;
+  }
+}
 
-    if (m3_GetRetCount(f) == 0) {
-      out = "(no return value)";
-      break;
+// Queue a call; the job id, or 0 when every slot is queued or running.
+// An owned buffer belongs to the job from here on, even on failure. With
+// input (moved into the job), func is called through the byte-buffer ABI
+// instead of with args.
+static int wasmSubmit(const uint8_t *bytes, size_t len, bool owned,
+                      const String &func, const String &args,
+                      const String &label, const WasmCall &limits,
+                      String *input = nullptr) {
+  std::lock_guard<std::mutex> g(gJobLock);
+  if (!gJobQueue) {
+    gJobQueue = xQueueCreate(WASM_JOBS, sizeof(int));
+    if (!gJobQueue || xTaskCreatePinnedToCore(wasmWorker, "aura-wasm",
+                                              24 * 1024, nullptr, 1, nullptr,
+                                              0) != pdPASS) {
+      Serial.println("[wasm] cannot start the worker task");
+      gJobQueue = nullptr;  // a half-made queue is simply leaked
+      if (owned) free((void *)bytes);
+      return 0;
     }
-    switch (m3_GetRetType(f, 0)) {
-      case c_m3Type_i32: {
-        int32_t v = 0;
-        m3_GetResultsV(f, &v);
-        out = String(v);
-      } break;
-      case c_m3Type_i64: {
-        int64_t v = 0;
-        m3_GetResultsV(f, &v);
-        char b[24];
-        snprintf(b, sizeof(b), "%lld", (long long)v);
-        out = b;
-      } break;
-      case c_m3Type_f32: {
-        float v = 0;
-        m3_GetResultsV(f, &v);
-        out = String(v, 6);
-      } break;
-      case c_m3Type_f64: {
-        double v = 0;
-        m3_GetResultsV(f, &v);
-        out = String(v, 6);
-      } break;
+  }
+  // a free slot, else the oldest finished job's
+  int at = -1;
+  for (int i = 0; i < WASM_JOBS && (at < 0 || gJobs[at].state != JOB_FREE);
+       i++)
+    if (gJobs[i].state == JOB_FREE ||
+        (gJobs[i].state == JOB_DONE && (at < 0 || gJobs[i].id < gJobs[at].id)))
+      at = i;
+  if (at < 0) {
+    if (owned) free((void *)bytes);
+    return 0;
+  }
+  WasmJob &j = gJobs[at];
+  j = WasmJob();
+  j.id = ++gJobSeq;
+  j.state = JOB_QUEUED;
+  j.bytes = bytes;
+  j.len = len;
+  j.owned = owned;
+  j.func = func;
+  j.args = args;
+  j.label = label;
+  if (input) {
+    j.feed = true;
+    j.input = std::move(*input);
+  }
+  j.call.limitMs = limits.limitMs;
+  j.call.limitSteps = limits.limitSteps;
+  xQueueSend(gJobQueue, &at, portMAX_DELAY);
+  return j.id;
+}
+
+// "job 7: running for 1234 ms", "job 7: queued", or the finished reply.
+static String wasmJobText(int id, bool *done = nullptr) {
+  std::lock_guard<std::mutex> g(gJobLock);
+  if (done) *done = false;
+  for (auto &j : gJobs) {
+    if (j.state == JOB_FREE || j.id != id) continue;
+    switch (j.state) {
+      case JOB_QUEUED:
+        return String("job ") + id + ": queued — " + j.label;
+      case JOB_RUNNING:
+        return String("job ") + id + ": running for " +
+               (millis() - j.startedAt) + " ms — " + j.label;
       default:
-        out = "(unsupported return type)";
+        if (done) *done = true;
+        return j.result;
     }
-  } while (0);
+  }
+  return String("job ") + id + ": unknown (only the last " + WASM_JOBS +
+         " are kept)";
+}
 
-  if (runtime) m3_FreeRuntime(runtime);
-  m3_FreeEnvironment(env);
-  return out;
+// Hand over a finished byte-buffer job's output: it is moved out, not
+// copied, so only the first caller gets it. False while the job runs, once
+// the output is taken, or when it returned no (or an empty) buffer.
+static bool wasmJobOutput(int id, String &out) {
+  std::lock_guard<std::mutex> g(gJobLock);
+  for (auto &j : gJobs)
+    if (j.state == JOB_DONE && j.id == id && j.output.length()) {
+      out = std::move(j.output);
+      j.output = String();  // moved-from is valid but unspecified
+      return true;
+    }
+  return false;
+}
+
+// Prompts: submit, then wait briefly so quick calls answer inline.
+static String wasmRunPrompt(const uint8_t *bytes, size_t len, bool owned,
+                            const String &func, const String &args,
+                            const String &label,
+                            String *input = nullptr) {
+  int id = wasmSubmit(bytes, len, owned, func, args, label, WasmCall(),
+                      input);
+  if (!id) return "wasm worker busy — every job slot is queued or running";
+  uint32_t t0 = millis();
+  bool done = false;
+  String out;
+  for (;;) {
+    out = wasmJobText(id, &done);
+    if (done || millis() - t0 >= WASM_PROMPT_WAIT_MS) break;
+    delay(5);
+  }
+  return done ? out
+              : out + "\n(still running — `job " + id + "` for the result)";
 }
 
 static String cmdFib(long n) {
   if (n < 0) n = 0;
-  if (n > 30)
-    return "fib is capped at n=30 here — the interpreter recursion gets slow. "
-           "Try `fib 30`.";
-  char nbuf[12];
-  snprintf(nbuf, sizeof(nbuf), "%ld", n);
-  const char *argv[1] = {nbuf};
-  int64_t us = 0;
-  String r = runWasmModule(FIB_WASM, sizeof(FIB_WASM), "fib", 1, argv, &us);
-  char tbuf[48];
-  snprintf(tbuf, sizeof(tbuf), "%.2f ms", us / 1000.0);
-  return String("wasm3 » fib(") + n + ") = " + r +
-         "\n(ran as WebAssembly on-chip in " + tbuf + ")";
+  String arg(n);
+  return wasmRunPrompt(FIB_WASM, sizeof(FIB_WASM), false, "fib", arg,
+                       "fib(" + arg + ")");
+}
+
+static String cmdJob(long id) { return wasmJobText(id); }
+
+// `wasm`: the warm-runtime cache, with each module's cold setup cost next
+// to its latest warm call.
+static String cmdWasmCache() {
+  std::lock_guard<std::mutex> g(gWasmLock);
+  String out = String("wasm runtime cache — ") + (int)(wasmCached() / 1024) +
+               " of " + (int)(wasmBudget() / 1024) + " KB, " + gWasm.hits +
+               " warm / " + gWasm.misses + " cold calls\n";
+  char line[96];
+  int n = 0;
+  for (auto &s : gWasm.slot) {
+    if (!s.used) continue;
+    snprintf(line, sizeof(line),
+             "  %08x  %6u B  %4u KB  %5u calls  cold setup %.2f ms, last "
+             "call %.2f ms\n",
+             (unsigned)s.hash, (unsigned)s.len, (unsigned)(s.cost / 1024),
+             (unsigned)s.calls, s.setupUs / 1000.0, s.lastUs / 1000.0);
+    out += line;
+    n++;
+  }
+  return n ? out : out + "  (empty)";
 }
+// crc32 and base64 over the byte-buffer ABI, 652 bytes. Memory: the crc
+// table at 0 (built on first use), the base64 alphabet at 1024 (a data
+// segment), then the arena at 2048.
+//   alloc(n)        grow memory to 2048 + 3n + 64, arena top after the
+//                   input; returns 2048 (0 if it cannot grow)
+//   crc32(p, n)     reflected CRC-32, poly 0xEDB88320 -> i32
+//   base64(p, n)    padded base64 at the arena top -> i64 ptr | len << 32
+static const uint8_t BYTES_WASM[] = {
+    0x00, 0x61, 0x73, 0x6d, 0x01, 0x00, 0x00, 0x00, 0x01, 0x12, 0x03, 0x60,
+    0x01, 0x7f, 0x01, 0x7f, 0x60, 0x02, 0x7f, 0x7f, 0x01, 0x7f, 0x60, 0x02,
+    0x7f, 0x7f, 0x01, 0x7e, 0x03, 0x04, 0x03, 0x00, 0x01, 0x02, 0x05, 0x03,
+    0x01, 0x00, 0x01, 0x06, 0x0c, 0x02, 0x7f, 0x01, 0x41, 0x80, 0x10, 0x0b,
+    0x7f, 0x01, 0x41, 0x00, 0x0b, 0x07, 0x23, 0x04, 0x06, 0x6d, 0x65, 0x6d,
+    0x6f, 0x72, 0x79, 0x02, 0x00, 0x05, 0x61, 0x6c, 0x6c, 0x6f, 0x63, 0x00,
+    0x00, 0x05, 0x63, 0x72, 0x63, 0x33, 0x32, 0x00, 0x01, 0x06, 0x62, 0x61,
+    0x73, 0x65, 0x36, 0x34, 0x00, 0x02, 0x0a, 0xe6, 0x03, 0x03, 0x3b, 0x01,
+    0x01, 0x7f, 0x20, 0x00, 0x41, 0x03, 0x6c, 0x41, 0xc0, 0x10, 0x6a, 0x41,
+    0xff, 0xff, 0x03, 0x6a, 0x41, 0x10, 0x76, 0x3f, 0x00, 0x6b, 0x22, 0x01,
+    0x41, 0x00, 0x4a, 0x04, 0x40, 0x20, 0x01, 0x40, 0x00, 0x41, 0x7f, 0x46,
+    0x04, 0x40, 0x41, 0x00, 0x0f, 0x0b, 0x0b, 0x20, 0x00, 0x41, 0x83, 0x10,
+    0x6a, 0x41, 0x7c, 0x71, 0x24, 0x00, 0x41, 0x80, 0x10, 0x0b, 0x9d, 0x01,
+    0x04, 0x01, 0x7f, 0x01, 0x7f, 0x01, 0x7f, 0x01, 0x7f, 0x23, 0x01, 0x45,
+    0x04, 0x40, 0x41, 0x00, 0x21, 0x03, 0x03, 0x40, 0x20, 0x03, 0x21, 0x02,
+    0x41, 0x08, 0x21, 0x04, 0x03, 0x40, 0x20, 0x02, 0x41, 0x01, 0x76, 0x41,
+    0xa0, 0x86, 0xe2, 0xed, 0x7e, 0x41, 0x00, 0x20, 0x02, 0x41, 0x01, 0x71,
+    0x6b, 0x71, 0x73, 0x21, 0x02, 0x20, 0x04, 0x41, 0x01, 0x6b, 0x22, 0x04,
+    0x0d, 0x00, 0x0b, 0x20, 0x03, 0x41, 0x02, 0x74, 0x20, 0x02, 0x36, 0x02,
+    0x00, 0x20, 0x03, 0x41, 0x01, 0x6a, 0x22, 0x03, 0x41, 0x80, 0x02, 0x49,
+    0x0d, 0x00, 0x0b, 0x41, 0x01, 0x24, 0x01, 0x0b, 0x41, 0x7f, 0x21, 0x02,
+    0x20, 0x00, 0x20, 0x01, 0x6a, 0x21, 0x05, 0x02, 0x40, 0x03, 0x40, 0x20,
+    0x00, 0x20, 0x05, 0x4f, 0x0d, 0x01, 0x20, 0x02, 0x20, 0x00, 0x2d, 0x00,
+    0x00, 0x73, 0x41, 0xff, 0x01, 0x71, 0x41, 0x02, 0x74, 0x28, 0x02, 0x00,
+    0x20, 0x02, 0x41, 0x08, 0x76, 0x73, 0x21, 0x02, 0x20, 0x00, 0x41, 0x01,
+    0x6a, 0x21, 0x00, 0x0c, 0x00, 0x0b, 0x0b, 0x20, 0x02, 0x41, 0x7f, 0x73,
+    0x0b, 0x88, 0x02, 0x04, 0x01, 0x7f, 0x01, 0x7f, 0x01, 0x7f, 0x01, 0x7f,
+    0x23, 0x00, 0x22, 0x05, 0x21, 0x02, 0x20, 0x00, 0x20, 0x01, 0x6a, 0x21,
+    0x03, 0x02, 0x40, 0x03, 0x40, 0x20, 0x03, 0x20, 0x00, 0x6b, 0x41, 0x03,
+    0x49, 0x0d, 0x01, 0x20, 0x00, 0x2d, 0x00, 0x00, 0x41, 0x10, 0x74, 0x20,
+    0x00, 0x2d, 0x00, 0x01, 0x41, 0x08, 0x74, 0x72, 0x20, 0x00, 0x2d, 0x00,
+    0x02, 0x72, 0x21, 0x04, 0x20, 0x02, 0x20, 0x04, 0x41, 0x12, 0x76, 0x2d,
+    0x00, 0x80, 0x08, 0x3a, 0x00, 0x00, 0x20, 0x02, 0x20, 0x04, 0x41, 0x0c,
+    0x76, 0x41, 0x3f, 0x71, 0x2d, 0x00, 0x80, 0x08, 0x3a, 0x00, 0x01, 0x20,
+    0x02, 0x20, 0x04, 0x41, 0x06, 0x76, 0x41, 0x3f, 0x71, 0x2d, 0x00, 0x80,
+    0x08, 0x3a, 0x00, 0x02, 0x20, 0x02, 0x20, 0x04, 0x41, 0x3f, 0x71, 0x2d,
+    0x00, 0x80, 0x08, 0x3a, 0x00, 0x03, 0x20, 0x00, 0x41, 0x03, 0x6a, 0x21,
+    0x00, 0x20, 0x02, 0x41, 0x04, 0x6a, 0x21, 0x02, 0x0c, 0x00, 0x0b, 0x0b,
+    0x20, 0x03, 0x20, 0x00, 0x6b, 0x04, 0x40, 0x20, 0x03, 0x20, 0x00, 0x6b,
+    0x41, 0x02, 0x46, 0x21, 0x03, 0x20, 0x00, 0x2d, 0x00, 0x00, 0x41, 0x10,
+    0x74, 0x20, 0x00, 0x2d, 0x00, 0x01, 0x41, 0x08, 0x74, 0x41, 0x00, 0x20,
+    0x03, 0x1b, 0x72, 0x21, 0x04, 0x20, 0x02, 0x20, 0x04, 0x41, 0x12, 0x76,
+    0x2d, 0x00, 0x80, 0x08, 0x3a, 0x00, 0x00, 0x20, 0x02, 0x20, 0x04, 0x41,
+    0x0c, 0x76, 0x41, 0x3f, 0x71, 0x2d, 0x00, 0x80, 0x08, 0x3a, 0x00, 0x01,
+    0x20, 0x02, 0x20, 0x04, 0x41, 0x06, 0x76, 0x41, 0x3f, 0x71, 0x2d, 0x00,
+    0x80, 0x08, 0x41, 0x3d, 0x20, 0x03, 0x1b, 0x3a, 0x00, 0x02, 0x20, 0x02,
+    0x41, 0x3d, 0x3a, 0x00, 0x03, 0x20, 0x02, 0x41, 0x04, 0x6a, 0x21, 0x02,
+    0x0b, 0x20, 0x05, 0xad, 0x20, 0x02, 0x20, 0x05, 0x6b, 0xad, 0x42, 0x20,
+    0x86, 0x84, 0x0b, 0x0b, 0x47, 0x01, 0x00, 0x41, 0x80, 0x08, 0x0b, 0x40,
+    0x41, 0x42, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4a, 0x4b, 0x4c,
+    0x4d, 0x4e, 0x4f, 0x50, 0x51, 0x52, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58,
+    0x59, 0x5a, 0x61, 0x62, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6a,
+    0x6b, 0x6c, 0x6d, 0x6e, 0x6f, 0x70, 0x71, 0x72, 0x73, 0x74, 0x75, 0x76,
+    0x77, 0x78, 0x79, 0x7a, 0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37,
+    0x38, 0x39, 0x2b, 0x2f,
+};
+
+static uint32_t crc32Native(const uint8_t *p, size_t n) {
+  static uint32_t table[256];
+  if (!table[1])
+    for (uint32_t i = 0; i < 256; i++) {
+      uint32_t c = i;
+      for (int k = 0; k < 8; k++) c = (c >> 1) ^ (0xEDB88320 & -(c & 1));
+      table[i] = c;
+    }
+  uint32_t c = 0xFFFFFFFF;
+  while (n--) c = table[(c ^ *p++) & 255] ^ (c >> 8);
+  return ~c;
+}
+
+static size_t base64Native(const uint8_t *p, size_t n, char *out) {
+  static const char A[] =
+      "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  char *o = out;
+  for (; n >= 3; n -= 3, p += 3, o += 4) {
+    uint32_t v = p[0] << 16 | p[1] << 8 | p[2];
+    o[0] = A[v >> 18];
+    o[1] = A[v >> 12 & 63];
+    o[2] = A[v >> 6 & 63];
+    o[3] = A[v & 63];
+  }
+  if (n) {
+    uint32_t v = p[0] << 16 | (n == 2 ? p[1] << 8 : 0);
+    o[0] = A[v >> 18];
+    o[1] = A[v >> 12 & 63];
+    o[2] = n == 2 ? A[v >> 6 & 63] : '=';
+    o[3] = '=';
+    o += 4;
+  }
+  return o - out;
+}
+
+// `bench bytes`: the byte-buffer ABI against the same kernels in C. Each
+// wasm round is a whole call: alloc, copy in, run, read the output back
+// (compared in place, no copy). Round 0 loads and warms the module.
+static String cmdBenchBytes() {
+  static const size_t sizes[] = {256, 4096, 16384};
+  const int kRounds = 20;
+  const size_t kMax = 16384;
+  uint8_t *in = (uint8_t *)malloc(kMax);
+  char *ref = (char *)malloc(kMax / 3 * 4 + 4);
+  if (!in || !ref) {
+    free(in);
+    free(ref);
+    return "bench bytes: no memory for the buffers";
+  }
+  for (size_t i = 0; i < kMax; i++) in[i] = esp_random();
+  String out = String("bench bytes — byte-buffer ABI (alloc, copy in, call, "
+                      "read back) vs native, ") + kRounds + " rounds\n"
+               "  kernel    bytes  native µs   wasm µs  x native  wasm MB/s"
+               "  same\n";
+  char line[112];
+  for (int k = 0; k < 2; k++) {
+    bool crc = k == 0;
+    const char *fn = crc ? "crc32" : "base64";
+    for (size_t n : sizes) {
+      volatile uint32_t sink = 0;
+      size_t refLen = 0;
+      int64_t t0 = esp_timer_get_time();
+      for (int r = 0; r < kRounds; r++) {
+        if (crc)
+          sink = sink + crc32Native(in, n);
+        else
+          refLen = base64Native(in, n, ref);
+      }
+      int64_t nativeUs = esp_timer_get_time() - t0;
+      String want = crc ? String((int32_t)crc32Native(in, n)) : String();
+      bool same = true;
+      int64_t wasmUs = 0;
+      for (int r = 0; r <= kRounds; r++) {
+        WasmCall call;
+        String got = runWasmBytes(
+            BYTES_WASM, sizeof(BYTES_WASM), fn, in, n,
+            [&](const uint8_t *p, size_t len) {
+              same = same && len == refLen && !memcmp(p, ref, len);
+            },
+            &call);
+        if (crc)
+          same = same && got == want;
+        else if (got.length())
+          same = false;  // an error, not a buffer
+        if (r) wasmUs += call.us;
+      }
+      snprintf(line, sizeof(line),
+               "  %-7s %7u  %9.1f %9.1f %9.1f  %9.2f  %s\n", fn, (unsigned)n,
+               nativeUs / (double)kRounds, wasmUs / (double)kRounds,
+               nativeUs ? wasmUs / (double)nativeUs : 0.0,
+               wasmUs ? n * (double)kRounds / wasmUs : 0.0,
+               same ? "yes" : "NO");
+      out += line;
+    }
+  }
+  free(in);
+  free(ref);
+  return out;
+}
+#else
+static String cmdFib(long) { return "fib runs on the chip (no wasm3 here)"; }
+static String cmdJob(long) { return "wasm runs on the chip (no wasm3 here)"; }
+static String cmdBenchBytes() {
+  return "bench bytes runs on the chip (no wasm3 here)";
+}
+#endif  // AURA_HOST
+
+// ------------------------------------------------------- wasm kernels -----
+#if !defined(AURA_HOST) || defined(AURA_WASM3)
+
+// `bench wasm`: six small kernels in one bundled module, 1699 bytes. They
+// run in a runtime of their own, outside the cache and the worker, so the
+// numbers follow the interpreter, the clock and where linear memory lives.
+// The host bench runs the same bytes when it is built with wasm3.
+// Memory: crc table at 0, sha256 K at 1024 (a data segment), its state at
+// 1280 and schedule at 1312, FIR taps at 1568, input 4096-36863, output
+// from 36864. Every kernel returns a checksum.
+//   init()       fill the input from an LCG, build the crc table and taps
+//   sieve(n)     primes below n, n <= 28672
+//   crc32(n)     CRC-32 of the first n input bytes
+//   sha256(n)    compress n 64-byte input blocks from the IV -> H0
+//   matmul(n)    n x n i32 product of two input matrices -> sum of C
+//   fir(n)       16-tap f32 FIR over n input bytes as samples -> sum of y
+//   memcpy(n)    copy n bytes, 8 at a time -> the last word
+static const uint8_t KERNELS_WASM[] = {
+    0x00, 0x61, 0x73, 0x6d, 0x01, 0x00, 0x00, 0x00, 0x01, 0x09, 0x02, 0x60,
+    0x00, 0x00, 0x60, 0x01, 0x7f, 0x01, 0x7f, 0x03, 0x08, 0x07, 0x00, 0x01,
+    0x01, 0x01, 0x01, 0x01, 0x01, 0x05, 0x03, 0x01, 0x00, 0x01, 0x07, 0x39,
+    0x07, 0x04, 0x69, 0x6e, 0x69, 0x74, 0x00, 0x00, 0x05, 0x73, 0x69, 0x65,
+    0x76, 0x65, 0x00, 0x01, 0x05, 0x63, 0x72, 0x63, 0x33, 0x32, 0x00, 0x02,
+    0x06, 0x73, 0x68, 0x61, 0x32, 0x35, 0x36, 0x00, 0x03, 0x06, 0x6d, 0x61,
+    0x74, 0x6d, 0x75, 0x6c, 0x00, 0x04, 0x03, 0x66, 0x69, 0x72, 0x00, 0x05,
+    0x06, 0x6d, 0x65, 0x6d, 0x63, 0x70, 0x79, 0x00, 0x06, 0x0a, 0xb8, 0x0a,
+    0x07, 0xaf, 0x01, 0x04, 0x01, 0x7f, 0x01, 0x7f, 0x01, 0x7f, 0x01, 0x7f,
+    0x41, 0x01, 0x21, 0x00, 0x41, 0x00, 0x21, 0x01, 0x03, 0x40, 0x20, 0x00,
+    0x41, 0xed, 0x9c, 0x99, 0x8e, 0x04, 0x6c, 0x41, 0xb9, 0xe0, 0x00, 0x6a,
+    0x21, 0x00, 0x20, 0x01, 0x20, 0x00, 0x41, 0x10, 0x76, 0x3a, 0x00, 0x80,
+    0x20, 0x20, 0x01, 0x41, 0x01, 0x6a, 0x22, 0x01, 0x41, 0x80, 0x80, 0x02,
+    0x49, 0x0d, 0x00, 0x0b, 0x41, 0x00, 0x21, 0x01, 0x03, 0x40, 0x20, 0x01,
+    0x21, 0x02, 0x41, 0x08, 0x21, 0x03, 0x03, 0x40, 0x20, 0x02, 0x41, 0x01,
+    0x76, 0x41, 0xa0, 0x86, 0xe2, 0xed, 0x7e, 0x41, 0x00, 0x20, 0x02, 0x41,
+    0x01, 0x71, 0x6b, 0x71, 0x73, 0x21, 0x02, 0x20, 0x03, 0x41, 0x01, 0x6b,
+    0x22, 0x03, 0x0d, 0x00, 0x0b, 0x20, 0x01, 0x41, 0x02, 0x74, 0x20, 0x02,
+    0x36, 0x02, 0x00, 0x20, 0x01, 0x41, 0x01, 0x6a, 0x22, 0x01, 0x41, 0x80,
+    0x02, 0x49, 0x0d, 0x00, 0x0b, 0x41, 0x00, 0x21, 0x01, 0x03, 0x40, 0x20,
+    0x01, 0x41, 0x02, 0x74, 0x20, 0x01, 0x41, 0x01, 0x6a, 0xb2, 0x43, 0x00,
+    0x00, 0x00, 0x3c, 0x94, 0x38, 0x02, 0xa0, 0x0c, 0x20, 0x01, 0x41, 0x01,
+    0x6a, 0x22, 0x01, 0x41, 0x10, 0x49, 0x0d, 0x00, 0x0b, 0x0b, 0x7c, 0x03,
+    0x01, 0x7f, 0x01, 0x7f, 0x01, 0x7f, 0x41, 0x00, 0x21, 0x01, 0x03, 0x40,
+    0x20, 0x01, 0x41, 0x00, 0x3a, 0x00, 0x80, 0xa0, 0x02, 0x20, 0x01, 0x41,
+    0x01, 0x6a, 0x22, 0x01, 0x20, 0x00, 0x49, 0x0d, 0x00, 0x0b, 0x41, 0x00,
+    0x21, 0x02, 0x41, 0x02, 0x21, 0x01, 0x02, 0x40, 0x03, 0x40, 0x20, 0x01,
+    0x20, 0x00, 0x4f, 0x0d, 0x01, 0x20, 0x01, 0x2d, 0x00, 0x80, 0xa0, 0x02,
+    0x45, 0x04, 0x40, 0x20, 0x02, 0x41, 0x01, 0x6a, 0x21, 0x02, 0x20, 0x01,
+    0x20, 0x01, 0x6c, 0x21, 0x03, 0x02, 0x40, 0x03, 0x40, 0x20, 0x03, 0x20,
+    0x00, 0x4f, 0x0d, 0x01, 0x20, 0x03, 0x41, 0x01, 0x3a, 0x00, 0x80, 0xa0,
+    0x02, 0x20, 0x03, 0x20, 0x01, 0x6a, 0x21, 0x03, 0x0c, 0x00, 0x0b, 0x0b,
+    0x0b, 0x20, 0x01, 0x41, 0x01, 0x6a, 0x21, 0x01, 0x0c, 0x00, 0x0b, 0x0b,
+    0x20, 0x02, 0x0b, 0x44, 0x02, 0x01, 0x7f, 0x01, 0x7f, 0x41, 0x7f, 0x21,
+    0x02, 0x41, 0x00, 0x21, 0x01, 0x02, 0x40, 0x03, 0x40, 0x20, 0x01, 0x20,
+    0x00, 0x4f, 0x0d, 0x01, 0x20, 0x02, 0x20, 0x01, 0x2d, 0x00, 0x80, 0x20,
+    0x73, 0x41, 0xff, 0x01, 0x71, 0x41, 0x02, 0x74, 0x28, 0x02, 0x00, 0x20,
+    0x02, 0x41, 0x08, 0x76, 0x73, 0x21, 0x02, 0x20, 0x01, 0x41, 0x01, 0x6a,
+    0x21, 0x01, 0x0c, 0x00, 0x0b, 0x0b, 0x20, 0x02, 0x41, 0x7f, 0x73, 0x0b,
+    0x83, 0x05, 0x0d, 0x01, 0x7f, 0x01, 0x7f, 0x01, 0x7f, 0x01, 0x7f, 0x01,
+    0x7f, 0x01, 0x7f, 0x01, 0x7f, 0x01, 0x7f, 0x01, 0x7f, 0x01, 0x7f, 0x01,
+    0x7f, 0x01, 0x7f, 0x01, 0x7f, 0x41, 0x00, 0x41, 0xe7, 0xcc, 0xa7, 0xd0,
+    0x06, 0x36, 0x02, 0x80, 0x0a, 0x41, 0x04, 0x41, 0x85, 0xdd, 0x9e, 0xdb,
+    0x7b, 0x36, 0x02, 0x80, 0x0a, 0x41, 0x08, 0x41, 0xf2, 0xe6, 0xbb, 0xe3,
+    0x03, 0x36, 0x02, 0x80, 0x0a, 0x41, 0x0c, 0x41, 0xba, 0xea, 0xbf, 0xaa,
+    0x7a, 0x36, 0x02, 0x80, 0x0a, 0x41, 0x10, 0x41, 0xff, 0xa4, 0xb9, 0x88,
+    0x05, 0x36, 0x02, 0x80, 0x0a, 0x41, 0x14, 0x41, 0x8c, 0xd1, 0x95, 0xd8,
+    0x79, 0x36, 0x02, 0x80, 0x0a, 0x41, 0x18, 0x41, 0xab, 0xb3, 0x8f, 0xfc,
+    0x01, 0x36, 0x02, 0x80, 0x0a, 0x41, 0x1c, 0x41, 0x99, 0x9a, 0x83, 0xdf,
+    0x05, 0x36, 0x02, 0x80, 0x0a, 0x41, 0x80, 0x20, 0x21, 0x01, 0x02, 0x40,
+    0x03, 0x40, 0x20, 0x00, 0x45, 0x0d, 0x01, 0x41, 0x00, 0x21, 0x02, 0x03,
+    0x40, 0x20, 0x02, 0x20, 0x01, 0x20, 0x02, 0x6a, 0x22, 0x03, 0x2d, 0x00,
+    0x00, 0x41, 0x18, 0x74, 0x20, 0x03, 0x2d, 0x00, 0x01, 0x41, 0x10, 0x74,
+    0x72, 0x20, 0x03, 0x2d, 0x00, 0x02, 0x41, 0x08, 0x74, 0x72, 0x20, 0x03,
+    0x2d, 0x00, 0x03, 0x72, 0x36, 0x02, 0xa0, 0x0a, 0x20, 0x02, 0x41, 0x04,
+    0x6a, 0x22, 0x02, 0x41, 0xc0, 0x00, 0x49, 0x0d, 0x00, 0x0b, 0x03, 0x40,
+    0x20, 0x02, 0x20, 0x02, 0x28, 0x02, 0xe0, 0x09, 0x20, 0x02, 0x28, 0x02,
+    0xe4, 0x09, 0x21, 0x03, 0x20, 0x03, 0x41, 0x07, 0x78, 0x20, 0x03, 0x41,
+    0x12, 0x78, 0x73, 0x20, 0x03, 0x41, 0x03, 0x76, 0x73, 0x6a, 0x20, 0x02,
+    0x28, 0x02, 0x84, 0x0a, 0x6a, 0x20, 0x02, 0x28, 0x02, 0x98, 0x0a, 0x21,
+    0x03, 0x20, 0x03, 0x41, 0x11, 0x78, 0x20, 0x03, 0x41, 0x13, 0x78, 0x73,
+    0x20, 0x03, 0x41, 0x0a, 0x76, 0x73, 0x6a, 0x36, 0x02, 0xa0, 0x0a, 0x20,
+    0x02, 0x41, 0x04, 0x6a, 0x22, 0x02, 0x41, 0x80, 0x02, 0x49, 0x0d, 0x00,
+    0x0b, 0x41, 0x00, 0x28, 0x02, 0x80, 0x0a, 0x21, 0x04, 0x41, 0x00, 0x28,
+    0x02, 0x84, 0x0a, 0x21, 0x05, 0x41, 0x00, 0x28, 0x02, 0x88, 0x0a, 0x21,
+    0x06, 0x41, 0x00, 0x28, 0x02, 0x8c, 0x0a, 0x21, 0x07, 0x41, 0x00, 0x28,
+    0x02, 0x90, 0x0a, 0x21, 0x08, 0x41, 0x00, 0x28, 0x02, 0x94, 0x0a, 0x21,
+    0x09, 0x41, 0x00, 0x28, 0x02, 0x98, 0x0a, 0x21, 0x0a, 0x41, 0x00, 0x28,
+    0x02, 0x9c, 0x0a, 0x21, 0x0b, 0x41, 0x00, 0x21, 0x02, 0x03, 0x40, 0x20,
+    0x0b, 0x20, 0x08, 0x41, 0x06, 0x78, 0x20, 0x08, 0x41, 0x0b, 0x78, 0x73,
+    0x20, 0x08, 0x41, 0x19, 0x78, 0x73, 0x6a, 0x20, 0x08, 0x20, 0x09, 0x71,
+    0x20, 0x08, 0x41, 0x7f, 0x73, 0x20, 0x0a, 0x71, 0x73, 0x6a, 0x20, 0x02,
+    0x28, 0x02, 0x80, 0x08, 0x6a, 0x20, 0x02, 0x28, 0x02, 0xa0, 0x0a, 0x6a,
+    0x21, 0x0c, 0x20, 0x04, 0x41, 0x02, 0x78, 0x20, 0x04, 0x41, 0x0d, 0x78,
+    0x73, 0x20, 0x04, 0x41, 0x16, 0x78, 0x73, 0x20, 0x04, 0x20, 0x05, 0x71,
+    0x20, 0x04, 0x20, 0x06, 0x71, 0x73, 0x20, 0x05, 0x20, 0x06, 0x71, 0x73,
+    0x6a, 0x21, 0x0d, 0x20, 0x0a, 0x21, 0x0b, 0x20, 0x09, 0x21, 0x0a, 0x20,
+    0x08, 0x21, 0x09, 0x20, 0x07, 0x20, 0x0c, 0x6a, 0x21, 0x08, 0x20, 0x06,
+    0x21, 0x07, 0x20, 0x05, 0x21, 0x06, 0x20, 0x04, 0x21, 0x05, 0x20, 0x0c,
+    0x20, 0x0d, 0x6a, 0x21, 0x04, 0x20, 0x02, 0x41, 0x04, 0x6a, 0x22, 0x02,
+    0x41, 0x80, 0x02, 0x49, 0x0d, 0x00, 0x0b, 0x41, 0x00, 0x41, 0x00, 0x28,
+    0x02, 0x80, 0x0a, 0x20, 0x04, 0x6a, 0x36, 0x02, 0x80, 0x0a, 0x41, 0x00,
+    0x41, 0x00, 0x28, 0x02, 0x84, 0x0a, 0x20, 0x05, 0x6a, 0x36, 0x02, 0x84,
+    0x0a, 0x41, 0x00, 0x41, 0x00, 0x28, 0x02, 0x88, 0x0a, 0x20, 0x06, 0x6a,
+    0x36, 0x02, 0x88, 0x0a, 0x41, 0x00, 0x41, 0x00, 0x28, 0x02, 0x8c, 0x0a,
+    0x20, 0x07, 0x6a, 0x36, 0x02, 0x8c, 0x0a, 0x41, 0x00, 0x41, 0x00, 0x28,
+    0x02, 0x90, 0x0a, 0x20, 0x08, 0x6a, 0x36, 0x02, 0x90, 0x0a, 0x41, 0x00,
+    0x41, 0x00, 0x28, 0x02, 0x94, 0x0a, 0x20, 0x09, 0x6a, 0x36, 0x02, 0x94,
+    0x0a, 0x41, 0x00, 0x41, 0x00, 0x28, 0x02, 0x98, 0x0a, 0x20, 0x0a, 0x6a,
+    0x36, 0x02, 0x98, 0x0a, 0x41, 0x00, 0x41, 0x00, 0x28, 0x02, 0x9c, 0x0a,
+    0x20, 0x0b, 0x6a, 0x36, 0x02, 0x9c, 0x0a, 0x20, 0x01, 0x41, 0xc0, 0x00,
+    0x6a, 0x21, 0x01, 0x20, 0x00, 0x41, 0x01, 0x6b, 0x21, 0x00, 0x0c, 0x00,
+    0x0b, 0x0b, 0x41, 0x00, 0x28, 0x02, 0x80, 0x0a, 0x0b, 0x92, 0x01, 0x05,
+    0x01, 0x7f, 0x01, 0x7f, 0x01, 0x7f, 0x01, 0x7f, 0x01, 0x7f, 0x41, 0x00,
+    0x21, 0x01, 0x41, 0x00, 0x21, 0x02, 0x03, 0x40, 0x41, 0x00, 0x21, 0x03,
+    0x03, 0x40, 0x41, 0x00, 0x21, 0x05, 0x41, 0x00, 0x21, 0x04, 0x03, 0x40,
+    0x20, 0x02, 0x20, 0x00, 0x6c, 0x20, 0x04, 0x6a, 0x41, 0x02, 0x74, 0x28,
+    0x02, 0x80, 0x20, 0x20, 0x04, 0x20, 0x00, 0x6c, 0x20, 0x03, 0x6a, 0x20,
+    0x00, 0x20, 0x00, 0x6c, 0x6a, 0x41, 0x02, 0x74, 0x28, 0x02, 0x80, 0x20,
+    0x6c, 0x20, 0x05, 0x6a, 0x21, 0x05, 0x20, 0x04, 0x41, 0x01, 0x6a, 0x22,
+    0x04, 0x20, 0x00, 0x49, 0x0d, 0x00, 0x0b, 0x20, 0x02, 0x20, 0x00, 0x6c,
+    0x20, 0x03, 0x6a, 0x41, 0x02, 0x74, 0x20, 0x05, 0x36, 0x02, 0x80, 0xa0,
+    0x02, 0x20, 0x01, 0x20, 0x05, 0x6a, 0x21, 0x01, 0x20, 0x03, 0x41, 0x01,
+    0x6a, 0x22, 0x03, 0x20, 0x00, 0x49, 0x0d, 0x00, 0x0b, 0x20, 0x02, 0x41,
+    0x01, 0x6a, 0x22, 0x02, 0x20, 0x00, 0x49, 0x0d, 0x00, 0x0b, 0x20, 0x01,
+    0x0b, 0x74, 0x04, 0x01, 0x7f, 0x01, 0x7f, 0x01, 0x7d, 0x01, 0x7d, 0x43,
+    0x00, 0x00, 0x00, 0x00, 0x21, 0x04, 0x41, 0x00, 0x21, 0x01, 0x02, 0x40,
+    0x03, 0x40, 0x20, 0x01, 0x20, 0x00, 0x4f, 0x0d, 0x01, 0x43, 0x00, 0x00,
+    0x00, 0x00, 0x21, 0x03, 0x41, 0x00, 0x21, 0x02, 0x03, 0x40, 0x20, 0x02,
+    0x41, 0x02, 0x74, 0x2a, 0x02, 0xa0, 0x0c, 0x20, 0x01, 0x20, 0x02, 0x6a,
+    0x2d, 0x00, 0x80, 0x20, 0xb2, 0x94, 0x20, 0x03, 0x92, 0x21, 0x03, 0x20,
+    0x02, 0x41, 0x01, 0x6a, 0x22, 0x02, 0x41, 0x10, 0x49, 0x0d, 0x00, 0x0b,
+    0x20, 0x01, 0x41, 0x02, 0x74, 0x20, 0x03, 0x38, 0x02, 0x80, 0xa0, 0x02,
+    0x20, 0x04, 0x20, 0x03, 0x92, 0x21, 0x04, 0x20, 0x01, 0x41, 0x01, 0x6a,
+    0x21, 0x01, 0x0c, 0x00, 0x0b, 0x0b, 0x20, 0x04, 0xa8, 0x0b, 0x35, 0x01,
+    0x01, 0x7f, 0x41, 0x00, 0x21, 0x01, 0x02, 0x40, 0x03, 0x40, 0x20, 0x01,
+    0x20, 0x00, 0x4f, 0x0d, 0x01, 0x20, 0x01, 0x20, 0x01, 0x29, 0x03, 0x80,
+    0x20, 0x37, 0x03, 0x80, 0xa0, 0x02, 0x20, 0x01, 0x41, 0x08, 0x6a, 0x21,
+    0x01, 0x0c, 0x00, 0x0b, 0x0b, 0x20, 0x00, 0x41, 0x04, 0x6b, 0x28, 0x02,
+    0x80, 0xa0, 0x02, 0x0b, 0x0b, 0x88, 0x02, 0x01, 0x00, 0x41, 0x80, 0x08,
+    0x0b, 0x80, 0x02, 0x98, 0x2f, 0x8a, 0x42, 0x91, 0x44, 0x37, 0x71, 0xcf,
+    0xfb, 0xc0, 0xb5, 0xa5, 0xdb, 0xb5, 0xe9, 0x5b, 0xc2, 0x56, 0x39, 0xf1,
+    0x11, 0xf1, 0x59, 0xa4, 0x82, 0x3f, 0x92, 0xd5, 0x5e, 0x1c, 0xab, 0x98,
+    0xaa, 0x07, 0xd8, 0x01, 0x5b, 0x83, 0x12, 0xbe, 0x85, 0x31, 0x24, 0xc3,
+    0x7d, 0x0c, 0x55, 0x74, 0x5d, 0xbe, 0x72, 0xfe, 0xb1, 0xde, 0x80, 0xa7,
+    0x06, 0xdc, 0x9b, 0x74, 0xf1, 0x9b, 0xc1, 0xc1, 0x69, 0x9b, 0xe4, 0x86,
+    0x47, 0xbe, 0xef, 0xc6, 0x9d, 0xc1, 0x0f, 0xcc, 0xa1, 0x0c, 0x24, 0x6f,
+    0x2c, 0xe9, 0x2d, 0xaa, 0x84, 0x74, 0x4a, 0xdc, 0xa9, 0xb0, 0x5c, 0xda,
+    0x88, 0xf9, 0x76, 0x52, 0x51, 0x3e, 0x98, 0x6d, 0xc6, 0x31, 0xa8, 0xc8,
+    0x27, 0x03, 0xb0, 0xc7, 0x7f, 0x59, 0xbf, 0xf3, 0x0b, 0xe0, 0xc6, 0x47,
+    0x91, 0xa7, 0xd5, 0x51, 0x63, 0xca, 0x06, 0x67, 0x29, 0x29, 0x14, 0x85,
+    0x0a, 0xb7, 0x27, 0x38, 0x21, 0x1b, 0x2e, 0xfc, 0x6d, 0x2c, 0x4d, 0x13,
+    0x0d, 0x38, 0x53, 0x54, 0x73, 0x0a, 0x65, 0xbb, 0x0a, 0x6a, 0x76, 0x2e,
+    0xc9, 0xc2, 0x81, 0x85, 0x2c, 0x72, 0x92, 0xa1, 0xe8, 0xbf, 0xa2, 0x4b,
+    0x66, 0x1a, 0xa8, 0x70, 0x8b, 0x4b, 0xc2, 0xa3, 0x51, 0x6c, 0xc7, 0x19,
+    0xe8, 0x92, 0xd1, 0x24, 0x06, 0x99, 0xd6, 0x85, 0x35, 0x0e, 0xf4, 0x70,
+    0xa0, 0x6a, 0x10, 0x16, 0xc1, 0xa4, 0x19, 0x08, 0x6c, 0x37, 0x1e, 0x4c,
+    0x77, 0x48, 0x27, 0xb5, 0xbc, 0xb0, 0x34, 0xb3, 0x0c, 0x1c, 0x39, 0x4a,
+    0xaa, 0xd8, 0x4e, 0x4f, 0xca, 0x9c, 0x5b, 0xf3, 0x6f, 0x2e, 0x68, 0xee,
+    0x82, 0x8f, 0x74, 0x6f, 0x63, 0xa5, 0x78, 0x14, 0x78, 0xc8, 0x84, 0x08,
+    0x02, 0xc7, 0x8c, 0xfa, 0xff, 0xbe, 0x90, 0xeb, 0x6c, 0x50, 0xa4, 0xf7,
+    0xa3, 0xf9, 0xbe, 0xf2, 0x78, 0x71, 0xc6,
+};
+
+struct WasmKernel {
+  const char *name;
+  int32_t arg, expect;  // expect: what every conforming runtime returns
+  double ops;           // work per call, in unit
+  const char *unit;
+};
+static const WasmKernel WASM_KERNELS[] = {
+    {"sieve", 16384, 1900, 16384, "numbers"},
+    {"crc32", 16384, -2031383629, 16384, "bytes"},
+    {"sha256", 16, 1428979888, 16, "blocks"},
+    {"matmul", 16, -530897081, 16 * 16 * 16, "MACs"},
+    {"fir", 2048, 273403, 2048 * 16, "MACs"},
+    {"memcpy", 16384, 900132281, 16384, "bytes"},
+};
+static const int WASM_KERNEL_RUNS = 21;  // timed, after one warm-up call
+
+// 1234567 -> "1.23 M"
+static String siRate(double v) {
+  char b[24];
+  if (v >= 1e6)
+    snprintf(b, sizeof(b), "%.2f M", v / 1e6);
+  else if (v >= 1e3)
+    snprintf(b, sizeof(b), "%.2f k", v / 1e3);
+  else
+    snprintf(b, sizeof(b), "%.0f", v);
+  return b;
+}
+
+static String cmdBenchWasm() {
+#ifndef AURA_HOST
+  std::lock_guard<std::mutex> g(gWasmLock);  // no call skews the timings
+#endif
+  IM3Environment env = m3_NewEnvironment();
+  IM3Runtime rt = env ? m3_NewRuntime(env, WASM_STACK_BYTES, NULL) : NULL;
+  IM3Module mod = NULL;
+  IM3Function f = NULL;
+  M3Result res = rt ? NULL : "no memory for a wasm runtime";
+  if (!res)
+    res = m3_ParseModule(env, &mod, KERNELS_WASM, sizeof(KERNELS_WASM));
+  if (!res && (res = m3_LoadModule(rt, mod))) m3_FreeModule(mod);
+  if (!res) res = m3_FindFunction(&f, rt, "init");
+  if (!res) res = m3_CallV(f);
+  String out;
+  if (res) {
+    out = String("bench wasm: ") + res;
+  } else {
+#ifndef AURA_HOST
+    uint32_t memLen = 0;
+    bool psram = esp_ptr_external_ram(m3_GetMemory(rt, &memLen, 0));
+    out = String("bench wasm — wasm3 ") + M3_VERSION + ", " +
+          getCpuFrequencyMhz() + " MHz, linear memory in " +
+          (psram ? "PSRAM" : "internal RAM");
+#else
+    out = String("bench wasm — wasm3 ") + M3_VERSION + ", host";
+#endif
+    out += String(", median of ") + WASM_KERNEL_RUNS + " runs\n" +
+           "  kernel     arg   median µs     p95 µs        ops/s  "
+           "unit     ok\n";
+    int64_t us[WASM_KERNEL_RUNS];
+    char line[112];
+    for (const WasmKernel &k : WASM_KERNELS) {
+      bool ok = true;
+      res = m3_FindFunction(&f, rt, k.name);
+      for (int r = -1; r < WASM_KERNEL_RUNS && !res; r++) {
+        int64_t t0 = esp_timer_get_time();
+        res = m3_CallV(f, k.arg);
+        if (r >= 0) us[r] = esp_timer_get_time() - t0;
+        int32_t got = 0;
+        if (!res) m3_GetResultsV(f, &got);
+        ok = ok && got == k.expect;
+      }
+      if (res) {
+        out += String("  ") + k.name + ": " + res + "\n";
+        res = NULL;
+        continue;
+      }
+      std::sort(us, us + WASM_KERNEL_RUNS);
+      int64_t med = us[WASM_KERNEL_RUNS / 2];
+      int64_t p95 = us[(WASM_KERNEL_RUNS * 95 + 99) / 100 - 1];
+      snprintf(line, sizeof(line),
+               "  %-7s %6d  %10.0f %10.0f %10s/s  %-7s  %s\n", k.name,
+               (int)k.arg, (double)med, (double)p95,
+               siRate(med ? k.ops * 1e6 / med : 0).c_str(), k.unit,
+               ok ? "yes" : "NO");
+      out += line;
+    }
+  }
+  if (rt) m3_FreeRuntime(rt);
+  if (env) m3_FreeEnvironment(env);
+  return out;
+}
+#else
+static String cmdBenchWasm() {
+  return "bench wasm needs wasm3 — on the chip, or the host bench built "
+         "with WASM3=<wasm3 source dir>";
+}
+#endif
 
 // ------------------------------------------------- TOON knowledge model -----
 
@@ -152,17 +1138,107 @@ struct ModelEntry {
   String t;
   String a;
   std::vector<std::pair<String, int>> k;
+  uint32_t aAt = 0;  // answer cell as it sits in the source: byte offset
+  uint16_t aRaw = 0;  // and length, quotes and escapes included
 };
 
-struct Model {
+// A parsed TOON pack. ToonParser fills the header fields; only the
+// reference parser collects entries here — loading streams them into a
+// ModelBuilder instead.
+struct ToonPack {
   String name, author, desc;
   int version = 0, threshold = 2;
   float temperature = 0.5f;  // 0 = always identical wording, 1 = max variety
   std::vector<ModelEntry> entries;
-  bool ok = false;
 };
 
-static Model gModel;
+// Compiled model arena: one block holding a header, a blob of
+// NUL-terminated strings (titles, answers, deduplicated keywords, header
+// fields), then struct-of-arrays tables:
+//   u32  entTitle[n] entAnswer[n] entKw0[n+1] kwStr[k] kwPost[k+1]
+//   u16  entAnsRaw[n] entKw[p] postEntry[p]
+//   u8   kwLen[k] entW[p] postW[p]
+// Entry i's keywords are entKw/entW[entKw0[i] .. entKw0[i+1]); keyword j's
+// postings are postEntry/postW[kwPost[j] .. kwPost[j+1]), in entry order.
+// Offsets only, so the same bytes serve in place from the flash partition
+// or from heap. With IMG_LAZY_ANSWERS, entAnswer/entAnsRaw locate each
+// answer cell in the TOON file instead, and the blob holds no answers.
+static const uint32_t IMG_MAGIC = 0x4d525541;  // "AURM"
+static const uint16_t IMG_FORMAT = 3;
+static const uint32_t IMG_LAZY_ANSWERS = 1;  // answers stay in the TOON file
+
+struct ImgHeader {
+  uint32_t magic;
+  uint16_t format, headerSize;
+  uint32_t flags;
+  uint32_t size;              // whole arena, bytes
+  uint32_t srcHash, srcSize;  // FNV-1a + length of the TOON it came from
+  int32_t version, threshold;
+  float temperature;
+  uint32_t nEntries, nKeywords, nPostings;
+  uint32_t name, author, desc;  // string blob offsets
+  uint32_t stringsSize;
+};
+
+// Table offsets, derived from the header counts.
+struct ImgLayout {
+  uint32_t strings, entTitle, entAnswer, entKw0, kwStr, kwPost;
+  uint32_t entAnsRaw, entKw, postEntry, kwLen, entW, postW, size;
+};
+
+static ImgLayout imgLayout(uint32_t n, uint32_t k, uint32_t p,
+                           uint32_t stringsSize) {
+  ImgLayout L;
+  L.strings = sizeof(ImgHeader);
+  L.entTitle = (L.strings + stringsSize + 3) & ~3u;
+  L.entAnswer = L.entTitle + 4 * n;
+  L.entKw0 = L.entAnswer + 4 * n;
+  L.kwStr = L.entKw0 + 4 * (n + 1);
+  L.kwPost = L.kwStr + 4 * k;
+  L.entAnsRaw = L.kwPost + 4 * (k + 1);
+  L.entKw = L.entAnsRaw + 2 * n;
+  L.postEntry = L.entKw + 2 * p;
+  L.kwLen = L.postEntry + 2 * p;
+  L.entW = L.kwLen + k;
+  L.postW = L.entW + p;
+  L.size = (L.postW + p + 3) & ~3u;
+  return L;
+}
+
+// Recently served lazy answers, least recently used evicted first.
+struct AnswerCache {
+  static const int SLOTS = 4;
+  int32_t entry[SLOTS] = {-1, -1, -1, -1};
+  uint32_t used[SLOTS] = {0};
+  String text[SLOTS];
+  uint32_t tick = 0, hits = 0, misses = 0;
+};
+
+// The loaded knowledge model: a view over one compiled arena.
+struct Model {
+  const char *name = "", *author = "", *desc = "";
+  int version = 0, threshold = 2;
+  float temperature = 0.5f;
+  bool ok = false;
+  uint32_t nEntries = 0, nKeywords = 0, nPostings = 0;
+  const ImgHeader *img = nullptr;
+  const char *str = nullptr;
+  const uint32_t *entTitle = nullptr, *entAnswer = nullptr, *entKw0 = nullptr;
+  const uint32_t *kwStr = nullptr, *kwPost = nullptr;
+  const uint16_t *entAnsRaw = nullptr, *entKw = nullptr, *postEntry = nullptr;
+  const uint8_t *kwLen = nullptr, *entW = nullptr, *postW = nullptr;
+  uint8_t *arena = nullptr;  // owned when not mapped from flash
+  bool mapped = false, lazy = false;  // lazy: answers read from src
+  String src = MODEL_PATH;            // the TOON file this was compiled from
+  bool retired = false;               // src was moved aside for this model
+  int refs = 1;                       // guarded by gModelLock
+  std::vector<uint16_t> sig;          // keyword signature, see packReach()
+  ImgMapHandle map = 0;
+  AnswerCache answers;
+  std::vector<int> score;         // per-entry accumulator, reused per query
+  std::vector<uint32_t> touched;  // entries with a non-zero accumulator
+  std::vector<uint32_t> hit;      // keywords matched by the query
+};
 
 // Factory-default TOON model, written to LittleFS on first boot.
 static const char DEFAULT_MODEL[] PROGMEM = R"mdl(name: automation
@@ -255,8 +1331,10 @@ static void parseKeywordCell(const String &cell, ModelEntry &e) {
   }
 }
 
-static bool parseToon(const String &text, Model &m, String &err) {
-  m = Model();
+// Whole-file reference parser: the text plus a String per line, field and
+// keyword. Loading uses ToonParser below; this stays for `bench parse`.
+static bool parseToonText(const String &text, ToonPack &m, String &err) {
+  m = ToonPack();
   int pos = 0, declared = -1;
   bool inEntries = false;
   while (pos < (int)text.length()) {
@@ -323,188 +1401,1847 @@ static bool parseToon(const String &text, Model &m, String &err) {
           (int)m.entries.size();
     return false;
   }
-  m.ok = true;
   return true;
 }
 
-static void ensureModelFile() {
-  if (LittleFS.exists("/model.json"))
-    LittleFS.remove("/model.json");  // migrate away from the old JSON era
-  if (LittleFS.exists(MODEL_PATH)) return;
-  Serial.println("[model] no model in FS — installing factory default");
-  File f = LittleFS.open(MODEL_PATH, "w");
-  if (!f) {
-    Serial.println("[model] ERROR: cannot create model file");
-    return;
-  }
-  f.print(FPSTR(DEFAULT_MODEL));
-  f.close();
-}
+// Streaming TOON parser: feed() byte chunks from any source, then
+// finish(). Lines go through one fixed buffer and rows are split in place,
+// each entry handed to onEntry as soon as its row ends, so memory stays
+// bounded by MAX_TOON_LINE plus one entry whatever the pack size. Same
+// errors as parseToonText(); errLine is the 1-based line they refer to.
+struct ToonParser {
+  ToonPack *hdr = nullptr;  // header fields; entries go to onEntry
+  std::function<bool(ModelEntry &)> onEntry;
+  // every header line, value as written (quotes kept); optional
+  std::function<void(const String &, const String &)> onField;
+  bool partial = false;  // a patch: no name or entries required
+  String err;
+  int lineNo = 0, errLine = 0;
+  int declared = -1, declaredLine = 0, count = 0;
+  bool inEntries = false, failed = false;
+  size_t len = 0;
+  uint32_t fed = 0, lineAt = 0;  // source offsets: bytes so far, line start
+  char line[MAX_TOON_LINE + 1];  // + NUL
 
-static void loadModel() {
-  File f = LittleFS.open(MODEL_PATH, "r");
-  if (!f) {
-    Serial.println("[model] ERROR: model file missing");
-    return;
+  void begin(ToonPack &p, std::function<bool(ModelEntry &)> cb) {
+    p = ToonPack();
+    hdr = &p;
+    onEntry = cb;
   }
-  String text = f.readString();
-  f.close();
-  String err;
-  if (!parseToon(text, gModel, err)) {
-    Serial.printf("[model] ERROR: %s\n", err.c_str());
-    return;
+  bool fail(const String &e, int at) {
+    err = e;
+    errLine = at;
+    failed = true;
+    return false;
   }
-  Serial.printf("[model] loaded \"%s\" v%d — %u entries (TOON %u bytes), "
-                "heap %u KB free\n",
-                gModel.name.c_str(), gModel.version,
-                (unsigned)gModel.entries.size(), (unsigned)text.length(),
-                (unsigned)(ESP.getFreeHeap() / 1024));
-}
-
-// Tokenize into lowercase alphanumeric words
-static int tokenizePrompt(const String &p, String *toks, int maxTok) {
-  int n = 0;
-  String cur;
-  for (unsigned int i = 0; i <= p.length() && n < maxTok; i++) {
-    char c = (i < p.length()) ? p[i] : ' ';
-    if (isalnum((unsigned char)c)) {
-      cur += (char)tolower((unsigned char)c);
-    } else if (cur.length()) {
-      toks[n++] = cur;
-      cur = "";
+  bool feed(const uint8_t *p, size_t n) {
+    for (size_t i = 0; i < n && !failed; i++) {
+      fed++;
+      if (p[i] == '\n') {
+        lineNo++;
+        endLine();
+        lineAt = fed;
+      } else if (len < sizeof(line) - 1) {
+        line[len++] = p[i];
+      } else {
+        return fail(String("line too long (max ") + (int)MAX_TOON_LINE +
+                        " bytes)",
+                    lineNo + 1);
+      }
     }
+    return !failed;
   }
-  return n;
-}
-
-static bool tokenMatches(const String &tok, const String &key) {
-  if (tok == key) return true;
-  unsigned int kl = key.length();
-  // light stemming: prefix match for words of 4+ chars
-  if (kl >= 4 && tok.length() > kl && tok.startsWith(key)) return true;
-  if (tok.length() >= 4 && kl > tok.length() && key.startsWith(tok))
+  bool finish() {
+    if (failed) return false;
+    if (len) {
+      lineNo++;
+      endLine();
+      if (failed) return false;
+    }
+    if (!partial && !hdr->name.length()) return fail("missing name", lineNo);
+    if (!partial && count == 0) return fail("no entries", lineNo);
+    if (declared >= 0 && count != declared)
+      return fail(String("entry count mismatch: declared ") + declared +
+                      ", found " + count,
+                  declaredLine);
     return true;
-  return false;
-}
-
-static String modelTopics() {
-  String out;
-  for (auto &e : gModel.entries) {
-    if (out.length()) out += ", ";
-    out += e.t;
   }
-  return out;
-}
-
-// "temperature" sampling: facts stay curated, presentation varies.
-static uint32_t rnd(uint32_t n) { return esp_random() % n; }
-static bool roll(float p) {
-  if (p <= 0.0f) return false;
-  return (esp_random() % 1000) < (uint32_t)(p * 1000.0f);
-}
 
-static String askModel(const String &prompt) {
-  if (!gModel.ok)
-    return "No knowledge model is loaded — install one in the Model panel "
-           "below.";
+  // Next field of an entry row starting at s[i]: quoted ("" escapes,
+  // unescaped in place) or bare (trimmed). NUL-terminates it in place.
+  static char *field(char *s, size_t n, size_t &i) {
+    while (i < n && s[i] == ' ') i++;
+    char *out = s + i;
+    if (i < n && s[i] == '"') {
+      size_t w = ++i;
+      out = s + w;
+      while (i < n) {
+        if (s[i] == '"') {
+          if (i + 1 < n && s[i + 1] == '"') {
+            s[w++] = '"';
+            i += 2;
+          } else {
+            i++;
+            break;
+          }
+        } else {
+          s[w++] = s[i++];
+        }
+      }
+      s[w] = 0;
+      while (i < n && s[i] != ',') i++;
+      if (i < n) i++;
+      return out;
+    }
+    size_t b = i;
+    while (i < n && s[i] != ',') i++;
+    size_t e = i;
+    if (i < n) i++;
+    while (b < e && isspace((unsigned char)s[b])) b++;
+    while (e > b && isspace((unsigned char)s[e - 1])) e--;
+    s[e] = 0;
+    return s + b;
+  }
 
-  String toks[24];
-  int nTok = tokenizePrompt(prompt, toks, 24);
+  void endLine() {
+    char *s = line;
+    size_t n = len;
+    len = 0;
+    while (n && isspace((unsigned char)s[n - 1])) n--;
+    while (n && isspace((unsigned char)*s)) s++, n--;
+    s[n] = 0;
+    if (!n || *s == '#') return;
 
-  int bestScore = 0, secondScore = 0;
-  const ModelEntry *best = nullptr, *second = nullptr;
-  for (auto &e : gModel.entries) {
-    int score = 0;
-    for (auto &kv : e.k) {
-      for (int i = 0; i < nTok; i++) {
-        if (tokenMatches(toks[i], kv.first)) {
-          score += kv.second;
-          break;  // each keyword counts once
+    if (!inEntries) {
+      if (!strncmp(s, "entries[", 8)) {
+        char *rb = strchr(s, ']');
+        if (!rb) {
+          fail("bad entries header", lineNo);
+          return;
         }
+        *rb = 0;
+        declared = atol(s + 8);
+        declaredLine = lineNo;
+        inEntries = true;
+        return;
+      }
+      char *c = strchr(s, ':');
+      if (!c) return;
+      *c = 0;
+      String key = s, val = c + 1;
+      key.trim();
+      val.trim();
+      if (onField) onField(key, val);
+      if (val.startsWith("\"") && val.endsWith("\"") && val.length() >= 2)
+        val = val.substring(1, val.length() - 1);
+      if (key == "name") hdr->name = val;
+      else if (key == "version") hdr->version = val.toInt();
+      else if (key == "author") hdr->author = val;
+      else if (key == "description") hdr->desc = val;
+      else if (key == "threshold") hdr->threshold = val.toInt();
+      else if (key == "temperature") hdr->temperature = val.toFloat();
+      return;
+    }
+
+    char near[41];
+    snprintf(near, sizeof(near), "%.40s", s);
+    char *f[3];
+    int nf = 0;
+    size_t i = 0;
+    size_t cell = 0;
+    while (i < n && nf < 3) {
+      cell = i;
+      f[nf++] = field(s, n, i);
+    }
+    if (nf != 3 || !*f[0] || !*f[1] || !*f[2]) {
+      fail(String("bad entry row near: ") + near, lineNo);
+      return;
+    }
+    ModelEntry e;
+    e.t = f[0];
+    e.a = f[2];
+    e.aAt = lineAt + (s - line) + cell;
+    e.aRaw = n - cell;
+    // keyword cell: "kw:weight kw2:weight ..." (weight defaults to 1)
+    char *save = nullptr;
+    for (char *k = strtok_r(f[1], " ", &save); k;
+         k = strtok_r(nullptr, " ", &save)) {
+      char *c = strchr(k, ':');
+      if (c && c > k) {
+        *c = 0;
+        e.k.push_back({String(k), (int)atol(c + 1)});
+      } else {
+        e.k.push_back({String(k), 1});
       }
     }
-    if (score > bestScore) {
-      secondScore = bestScore;
-      second = best;
-      bestScore = score;
-      best = &e;
-    } else if (score > secondScore) {
-      secondScore = score;
-      second = &e;
+    if (e.k.empty()) {
+      fail(String("entry has no keywords: ") + e.t, lineNo);
+      return;
     }
+    count++;
+    if (onEntry && !onEntry(e) && !failed)
+      fail(String("entry rejected: ") + e.t, lineNo);
   }
+};
 
-  float T = gModel.temperature;
-  Serial.printf("[model] query scored %d (threshold %d, temperature %.1f)\n",
-                bestScore, gModel.threshold, T);
+// Compressed packs. A pack file is plain TOON or TZ1, a byte-oriented
+// LZSS in the spirit of heatshrink: the text in 16 KB blocks, each
+// compressed on its own with a 4 KB window — decoding needs 4 KB of RAM
+// and can start at any block — followed by the block index:
+//   "\0TZ1" | blocks | u32 block offset[n] | u32 text size | u32 n
+// A block is groups of eight items behind a flag byte, bit i set when
+// item i is a literal byte; a match is 12 bits of distance - 1 and 4 of
+// length - 3, length 15 adding the next byte. TOON text holds no NUL, so
+// the magic never starts a plain pack.
+static const uint8_t TZ_MAGIC[4] = {0, 'T', 'Z', '1'};
+static const uint32_t TZ_BLOCK = 16384, TZ_WINDOW = 4096, TZ_MIN = 3,
+                      TZ_MAX = TZ_MIN + 15 + 255;
 
-  if (!best || bestScore < gModel.threshold) {
-    switch (roll(T) ? rnd(3) : 0) {
+// Reads a pack — plain or TZ1, a LittleFS file or bytes in memory — as
+// TOON text. seek() takes text offsets; in TZ1 it decodes from the start
+// of the block holding them.
+struct PackFile {
+  File f;
+  const uint8_t *mem = nullptr;
+  size_t stored = 0;               // bytes in the file or buffer
+  bool z = false, bad = false;     // TZ1; corrupt data seen
+  uint32_t size = 0, pos = 0;      // text size, text offset of the next read
+  std::vector<uint32_t> blockAt;   // TZ1 block offsets, then the index's
+  std::vector<uint8_t> win;        // the last TZ_WINDOW bytes decoded
+  uint32_t w = 0, block = 0, blockEnd = 0, in = 0, inEnd = 0;
+  uint8_t buf[256];
+  uint32_t bufAt = 0, bufLen = 0;
+  uint8_t flags = 0, items = 0, lit = 0;
+  uint32_t dist = 0, left = 0;     // the item being copied out
+
+  bool open(const char *path) {
+    f = LittleFS.open(path, "r");
+    return f && start(f.size());
+  }
+  bool open(const uint8_t *p, size_t n) {
+    mem = p;
+    return start(n);
+  }
+  void close() {
+    if (f) f.close();
+  }
+
+  size_t raw(uint32_t at, void *p, size_t n) {
+    if (mem) {
+      n = at < stored ? std::min(n, stored - at) : 0;
+      memcpy(p, mem + at, n);
+      return n;
+    }
+    return f.seek(at) ? f.read((uint8_t *)p, n) : 0;
+  }
+  bool start(size_t n) {
+    stored = n;
+    uint8_t head[4];
+    z = n >= 16 && raw(0, head, 4) == 4 && !memcmp(head, TZ_MAGIC, 4);
+    if (!z) {
+      size = n;
+      return seek(0);
+    }
+    uint32_t tail[2];  // text size, blocks
+    if (raw(n - 8, tail, 8) != 8 || !tail[1] || tail[1] > (n - 12) / 4 ||
+        (tail[0] + TZ_BLOCK - 1) / TZ_BLOCK != tail[1])
+      return false;
+    size = tail[0];
+    blockAt.resize(tail[1] + 1);
+    blockAt[tail[1]] = n - 8 - 4 * tail[1];
+    if (raw(blockAt[tail[1]], blockAt.data(), 4 * tail[1]) != 4 * tail[1])
+      return false;
+    for (uint32_t b = 0; b < tail[1]; b++)
+      if (blockAt[b] < (b ? blockAt[b - 1] : 4) || blockAt[b] > blockAt[b + 1])
+        return false;
+    win.assign(TZ_WINDOW, 0);
+    blockEnd = 0;  // no block entered yet
+    return seek(0);
+  }
+
+  void enter(uint32_t b) {
+    block = b;
+    pos = b * TZ_BLOCK;
+    blockEnd = std::min(size, pos + TZ_BLOCK);
+    in = blockAt[b];
+    inEnd = blockAt[b + 1];
+    bufAt = bufLen = 0;
+    items = 0;
+    left = 0;
+  }
+  uint8_t next() {
+    if (bufAt == bufLen) {
+      bufAt = 0;
+      bufLen = in < inEnd ? raw(in, buf, std::min<uint32_t>(sizeof(buf),
+                                                            inEnd - in))
+                          : 0;
+      in += bufLen;
+      if (!bufLen) {
+        bad = true;
+        return 0;
+      }
+    }
+    return buf[bufAt++];
+  }
+
+  bool seek(uint32_t at) {
+    if (at > size) return false;
+    if (!z) {
+      pos = at;
+      return mem || f.seek(at);
+    }
+    if (at == size) {
+      pos = at;
+      return true;
+    }
+    if (!blockEnd || at < pos || at / TZ_BLOCK != block)
+      enter(at / TZ_BLOCK);
+    uint32_t skip = at - pos;
+    return read(nullptr, skip) == skip && !bad;
+  }
+
+  // Up to n text bytes into p (TZ1 only: nullptr skips them).
+  size_t read(uint8_t *p, size_t n) {
+    if (!z) {
+      n = raw(pos, p, n);
+      pos += n;
+      return n;
+    }
+    size_t got = 0;
+    while (got < n && pos < size && !bad) {
+      if (pos == blockEnd) enter(pos / TZ_BLOCK);
+      if (!left) {
+        if (!items) {
+          flags = next();
+          items = 8;
+        }
+        items--;
+        if (flags & 1) {
+          dist = 0;
+          lit = next();
+          left = 1;
+        } else {
+          uint8_t a = next(), b = next();
+          dist = ((a << 4) | (b >> 4)) + 1;
+          left = (b & 15) + TZ_MIN + ((b & 15) == 15 ? next() : 0);
+          bad = bad || dist > pos - block * TZ_BLOCK;
+        }
+        flags >>= 1;
+      }
+      uint8_t c = dist ? win[(w - dist) & (TZ_WINDOW - 1)] : lit;
+      win[w++ & (TZ_WINDOW - 1)] = c;
+      if (p) p[got] = c;
+      got++;
+      pos++;
+      left--;
+    }
+    return got;
+  }
+};
+
+// Writes TZ1 as text arrives: a block is buffered and compressed when
+// full, greedy matches found through a hash chain over the window. About
+// 32 KB of heap while it runs.
+struct PackWriter {
+  File &out;
+  bool ok;
+  uint32_t at = 4, size = 0;  // file bytes written, text bytes taken
+  std::vector<uint8_t> blk;
+  std::vector<uint16_t> head, prev;  // chain links: position + 1, 0 = none
+  std::vector<uint32_t> index;
+  uint8_t stage[256];
+  size_t staged = 0;
+
+  explicit PackWriter(File &f) : out(f) {
+    ok = out.write(TZ_MAGIC, 4) == 4;
+    blk.reserve(TZ_BLOCK);
+  }
+  bool write(const uint8_t *p, size_t n) {
+    while (ok && n) {
+      size_t take = std::min<size_t>(n, TZ_BLOCK - blk.size());
+      blk.insert(blk.end(), p, p + take);
+      p += take;
+      n -= take;
+      size += take;
+      if (blk.size() == TZ_BLOCK) flush();
+    }
+    return ok;
+  }
+  bool write(const String &s) {
+    return write((const uint8_t *)s.c_str(), s.length());
+  }
+  bool finish() {
+    if (blk.size()) flush();
+    emit(nullptr, 0);
+    uint32_t tail[2] = {size, (uint32_t)index.size()};
+    ok = ok && out.write((const uint8_t *)index.data(), 4 * index.size()) ==
+                   4 * index.size();
+    ok = ok && out.write((const uint8_t *)tail, 8) == 8;
+    return ok;
+  }
+
+  void emit(const uint8_t *p, size_t n) {  // nullptr: drain the stage
+    if (staged + n > sizeof(stage) || !p) {
+      ok = ok && out.write(stage, staged) == staged;
+      at += staged;
+      staged = 0;
+    }
+    if (p) memcpy(stage + staged, p, n);
+    staged += n;
+  }
+  static uint32_t hash3(const uint8_t *p) {
+    return ((p[0] << 8) ^ (p[1] << 4) ^ p[2]) & (TZ_WINDOW - 1);
+  }
+  void flush() {
+    emit(nullptr, 0);
+    index.push_back(at);
+    head.assign(TZ_WINDOW, 0);
+    prev.assign(TZ_WINDOW, 0);
+    uint8_t group[1 + 8 * 3];
+    size_t g = 1, items = 0;
+    group[0] = 0;
+    const uint8_t *b = blk.data();
+    uint32_t n = blk.size();
+    for (uint32_t i = 0; i < n;) {
+      uint32_t best = 0, dist = 0;
+      if (i + TZ_MIN <= n) {
+        uint32_t h = hash3(b + i), lim = std::min(TZ_MAX, n - i);
+        int chain = 32;
+        for (uint32_t c = head[h]; c && chain--;
+             c = prev[(c - 1) & (TZ_WINDOW - 1)]) {
+          uint32_t j = c - 1;
+          if (i - j > TZ_WINDOW) break;
+          uint32_t len = 0;
+          while (len < lim && b[j + len] == b[i + len]) len++;
+          if (len > best) best = len, dist = i - j;
+          if (len == lim) break;
+        }
+      }
+      uint32_t step = best >= TZ_MIN ? best : 1;
+      if (step == 1) {
+        group[0] |= 1 << items;
+        group[g++] = b[i];
+      } else {
+        uint32_t l = best - TZ_MIN;
+        group[g++] = (dist - 1) >> 4;
+        group[g++] = ((dist - 1) & 15) << 4 | std::min<uint32_t>(l, 15);
+        if (l >= 15) group[g++] = l - 15;
+      }
+      for (uint32_t k = 0; k < step; k++, i++)
+        if (i + TZ_MIN <= n) {
+          uint32_t h = hash3(b + i);
+          prev[i & (TZ_WINDOW - 1)] = head[h];
+          head[h] = i + 1;
+        }
+      if (++items == 8) {
+        emit(group, g);
+        g = 1, items = 0, group[0] = 0;
+      }
+    }
+    if (items) emit(group, g);
+    blk.clear();
+  }
+};
+
+// Push a whole pack through tp.
+static bool feedToon(ToonParser &tp, PackFile &f) {
+  uint8_t buf[256];
+  size_t n;
+  while ((n = f.read(buf, sizeof(buf))) > 0 && tp.feed(buf, n)) {
+  }
+  if (f.bad || f.pos != f.size)
+    return tp.fail("corrupt compressed pack", tp.lineNo + 1);
+  return tp.finish();
+}
+
+// Store TOON text at path, as TZ1.
+static bool writePack(const char *path, const uint8_t *text, size_t len) {
+  File f = LittleFS.open(path, "w");
+  if (!f) return false;
+  PackWriter w(f);
+  bool ok = w.write(text, len) && w.finish();
+  f.close();
+  return ok;
+}
+
+static void ensureModelFile() {
+  if (LittleFS.exists("/model.json"))
+    LittleFS.remove("/model.json");  // migrate away from the old JSON era
+  if (LittleFS.exists(MODEL_PATH)) return;
+  Serial.println("[model] no model in FS — installing factory default");
+  if (!writePack(MODEL_PATH, (const uint8_t *)DEFAULT_MODEL,
+                 sizeof(DEFAULT_MODEL) - 1))
+    Serial.println("[model] ERROR: cannot create model file");
+}
+
+// Of the text, so a pack keeps its hash whether it is stored as TZ1 or not.
+static uint32_t hashPack(PackFile &f) {
+  uint8_t buf[256];
+  uint32_t h = FNV_SEED;
+  f.seek(0);
+  size_t n;
+  while ((n = f.read(buf, sizeof(buf))) > 0) h = fnv1a(h, buf, n);
+  f.seek(0);
+  return h;
+}
+
+static const esp_partition_t *modelPartition() {
+  return esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                  ESP_PARTITION_SUBTYPE_ANY, MODEL_PARTITION);
+}
+
+// Models currently mapping the partition; it is only rewritten at zero.
+static std::atomic<int> gPartitionMaps(0);
+
+static void releaseModel(Model &m) {
+  if (m.retired) LittleFS.remove(m.src.c_str());
+  if (m.mapped) {
+    imgMunmap(m.map);
+    gPartitionMaps--;
+  }
+  free(m.arena);
+  m = Model();
+}
+
+// The live knowledge packs: MODEL_PATH first, then every pack under
+// MODELS_DIR by name. A query pins the set with LiveModels for as long as
+// it reads the arenas; an install compiles a new Model, publishes a copy of
+// the set with it swapped in, so queries already running finish on the
+// old set and the last of them frees it. Sets hold one reference to each
+// of their packs, and the live pointer one to the set.
+struct ModelSet {
+  std::vector<Model *> packs;
+  uint32_t hash = 0;  // of every pack's source hash; keys the prompt cache
+  int refs = 1;       // guarded by gModelLock
+};
+
+static std::mutex gModelLock;
+static ModelSet *gLive = new ModelSet();
+
+// Drop a reference, if any; the last one frees m.
+static void modelRelease(Model *m) {
+  if (!m) return;
+  bool last;
+  {
+    std::lock_guard<std::mutex> g(gModelLock);
+    last = --m->refs == 0;
+  }
+  if (!last) return;
+  releaseModel(*m);
+  delete m;
+}
+
+static ModelSet *modelsAcquire() {
+  std::lock_guard<std::mutex> g(gModelLock);
+  gLive->refs++;
+  return gLive;
+}
+
+static void modelsRelease(ModelSet *s) {
+  bool last;
+  {
+    std::lock_guard<std::mutex> g(gModelLock);
+    last = --s->refs == 0;
+  }
+  if (!last) return;
+  for (Model *m : s->packs) modelRelease(m);
+  delete s;
+}
+
+// Make next the live set. Queries still reading the old one finish on it,
+// and the last of them frees it.
+static void modelsPublish(ModelSet *next) {
+  next->hash = FNV_SEED;
+  for (Model *m : next->packs)
+    next->hash = fnv1a(next->hash, (const uint8_t *)&m->img->srcHash, 4);
+  ModelSet *old;
+  {
+    std::lock_guard<std::mutex> g(gModelLock);
+    old = gLive;
+    gLive = next;
+  }
+  modelsRelease(old);
+}
+
+// Pack order: MODEL_PATH, then by file name.
+static bool packBefore(const String &a, const String &b) {
+  bool da = a == MODEL_PATH, db = b == MODEL_PATH;
+  return da != db ? da : strcmp(a.c_str(), b.c_str()) < 0;
+}
+
+// Publish the live set with the pack at path replaced by m, or m added in
+// order when there is none; a null m just drops it. m may still be
+// reading a temporary file. Takes over the caller's reference to m;
+// returns the pack it replaced, with a reference for the caller, or null.
+static Model *modelsSwap(const String &path, Model *m) {
+  ModelSet *next = new ModelSet();
+  Model *old = nullptr;
+  {
+    std::lock_guard<std::mutex> g(gModelLock);
+    for (Model *p : gLive->packs) {
+      p->refs++;
+      if (p->src == path)
+        old = p;
+      else
+        next->packs.push_back(p);
+    }
+  }
+  size_t at = 0;
+  while (at < next->packs.size() && packBefore(next->packs[at]->src, path))
+    at++;
+  if (m) next->packs.insert(next->packs.begin() + at, m);
+  modelsPublish(next);
+  return old;
+}
+
+struct LiveModels {
+  ModelSet *s;
+  LiveModels() : s(modelsAcquire()) {}
+  ~LiveModels() { modelsRelease(s); }
+  LiveModels(const LiveModels &) = delete;
+  LiveModels &operator=(const LiveModels &) = delete;
+  ModelSet &operator*() const { return *s; }
+  ModelSet *operator->() const { return s; }
+};
+
+// Keyword signature: a two-probe weighted Bloom filter over keywords. A
+// prompt word and a keyword can only match when they share their first
+// four characters (or are the same shorter word), so only those are
+// hashed; a bucket sums the top weight of every keyword hashed into it,
+// and the smaller of a word's two buckets bounds what the word can add
+// to any entry's score.
+static uint32_t sigHash(const char *s, size_t n) {
+  uint32_t h = fnv1a(FNV_SEED, (const uint8_t *)s, n < 4 ? n : 4);
+  h ^= h >> 16;
+  h *= 0x85ebca6bu;
+  return h ^ (h >> 13);
+}
+
+static void buildSignature(Model &m) {
+  uint32_t size = 64;
+  while (size < m.nKeywords && size < 2048) size <<= 1;
+  m.sig.assign(size, 0);
+  for (uint32_t k = 0; k < m.nKeywords; k++) {
+    // top weight one entry gives k; a row may list a keyword twice, and
+    // postings are in entry order
+    uint32_t w = 0, run = 0;
+    for (uint32_t p = m.kwPost[k]; p < m.kwPost[k + 1]; p++) {
+      bool same = p > m.kwPost[k] && m.postEntry[p] == m.postEntry[p - 1];
+      run = (same ? run : 0) + m.postW[p];
+      if (run > w) w = run;
+    }
+    uint32_t h = sigHash(m.str + m.kwStr[k], m.kwLen[k]);
+    uint32_t a = h & (size - 1), b = (h >> 16) & (size - 1);
+    m.sig[a] = std::min<uint32_t>(65535, m.sig[a] + w);
+    if (b != a) m.sig[b] = std::min<uint32_t>(65535, m.sig[b] + w);
+  }
+}
+
+// The check that replaces a parse on every boot: magic, format and a
+// layout recomputed from the counts. Points the Model into the arena.
+static bool attachImage(Model &m, const uint8_t *base, size_t cap,
+                        String &err) {
+  const ImgHeader *h = (const ImgHeader *)base;
+  if (cap < sizeof(ImgHeader) || h->magic != IMG_MAGIC) {
+    err = "no compiled image";
+    return false;
+  }
+  ImgLayout L;
+  if (h->format != IMG_FORMAT || h->headerSize != sizeof(ImgHeader) ||
+      h->size > cap || h->nEntries > 65535 || h->nKeywords > 65535 ||
+      h->nPostings > cap || h->stringsSize > cap ||
+      (L = imgLayout(h->nEntries, h->nKeywords, h->nPostings,
+                     h->stringsSize)).size != h->size) {
+    err = "stale or damaged image";
+    return false;
+  }
+  m.img = h;
+  m.str = (const char *)(base + L.strings);
+  m.entTitle = (const uint32_t *)(base + L.entTitle);
+  m.entAnswer = (const uint32_t *)(base + L.entAnswer);
+  m.entKw0 = (const uint32_t *)(base + L.entKw0);
+  m.kwStr = (const uint32_t *)(base + L.kwStr);
+  m.kwPost = (const uint32_t *)(base + L.kwPost);
+  m.entAnsRaw = (const uint16_t *)(base + L.entAnsRaw);
+  m.entKw = (const uint16_t *)(base + L.entKw);
+  m.postEntry = (const uint16_t *)(base + L.postEntry);
+  m.kwLen = base + L.kwLen;
+  m.entW = base + L.entW;
+  m.postW = base + L.postW;
+  m.name = m.str + h->name;
+  m.author = m.str + h->author;
+  m.desc = m.str + h->desc;
+  m.version = h->version;
+  m.threshold = h->threshold;
+  m.temperature = h->temperature;
+  m.nEntries = h->nEntries;
+  m.nKeywords = h->nKeywords;
+  m.nPostings = h->nPostings;
+  m.lazy = h->flags & IMG_LAZY_ANSWERS;
+  m.score.assign(m.nEntries, 0);
+  m.touched.clear();
+  m.touched.reserve(m.nEntries);
+  m.hit.clear();
+  m.hit.reserve(m.nKeywords < 256 ? m.nKeywords : 256);
+  buildSignature(m);
+  m.ok = true;
+  return true;
+}
+
+static bool mapModelPartition(Model &m, const esp_partition_t *part,
+                              String &err) {
+  const void *p = nullptr;
+  if (esp_partition_mmap(part, 0, part->size, IMG_MMAP_DATA, &p, &m.map) !=
+      ESP_OK) {
+    err = "cannot map model partition";
+    return false;
+  }
+  m.mapped = true;
+  gPartitionMaps++;
+  if (!attachImage(m, (const uint8_t *)p, part->size, err)) {
+    releaseModel(m);
+    return false;
+  }
+  return true;
+}
+
+static uint8_t *imgAlloc(size_t n) {
+  uint8_t *p = psramFound() ? (uint8_t *)ps_malloc(n) : nullptr;
+  return p ? p : (uint8_t *)malloc(n);
+}
+
+static uint8_t *imgRealloc(uint8_t *old, size_t n) {
+  uint8_t *p = psramFound() ? (uint8_t *)ps_realloc(old, n) : nullptr;
+  return p ? p : (uint8_t *)realloc(old, n);
+}
+
+// Arena field widths: u16 entry/keyword ids, u8 keyword lengths and weights.
+static bool entryFits(const ModelEntry &e, size_t index, String &err) {
+  if (index >= 65535) {
+    err = "too many entries (max 65535)";
+    return false;
+  }
+  for (auto &kv : e.k) {
+    if (kv.second < 0 || kv.second > 255) {
+      err = String("keyword weight must be 0-255: ") + kv.first;
+      return false;
+    }
+    if (kv.first.length() > 255) {
+      err = String("keyword too long: ") + kv.first.substring(0, 40);
+      return false;
+    }
+  }
+  return true;
+}
+
+// Install-time check: parse and range-check without keeping anything.
+static void checkEntries(ToonParser &tp, ToonPack &hdr) {
+  ToonParser *t = &tp;
+  tp.begin(hdr, [t](ModelEntry &e) {
+    String why;
+    return entryFits(e, t->count - 1, why) || t->fail(why, t->lineNo);
+  });
+}
+
+static bool validateToon(PackFile &src, ToonPack &hdr, int &count,
+                         String &err, int &line) {
+  ToonParser *tp = new ToonParser();
+  checkEntries(*tp, hdr);
+  bool ok = feedToon(*tp, src);
+  count = tp->count;
+  err = tp->err;
+  line = tp->errLine;
+  delete tp;
+  return ok;
+}
+
+static const char *ERR_PARTITION_FULL =
+    "model arena exceeds the aura_model partition";
+
+// Builds a model arena from streamed entries. Strings are appended as rows
+// arrive — into one growing heap block, or straight to the partition
+// through a small staging buffer, erasing sectors just ahead of the
+// writes. Keywords are deduplicated through an open-addressing table;
+// finish() sorts them, lays the tables out behind the strings and writes
+// the header last, so a torn flash write never looks valid. Build state
+// is a few bytes per entry and keyword occurrence.
+struct ModelBuilder {
+  const esp_partition_t *part = nullptr;
+  uint8_t *heap = nullptr;
+  size_t cap = 0, pos = 0;  // pos: next arena byte to write
+  uint8_t stage[256];
+  size_t staged = 0, at = 0, erased = 0;
+  String err;
+  bool lazy = false;  // record answer cells by source offset, not text
+  std::vector<uint32_t> title, answer, kw0;  // per entry
+  std::vector<uint16_t> ansRaw;
+  std::vector<uint32_t> fwdKw;               // per occurrence: build id
+  std::vector<uint8_t> fwdW;
+  std::vector<char> kwText;  // build-time keyword dictionary
+  std::vector<uint32_t> kwOff, slots;
+
+  bool begin(const esp_partition_t *p, size_t hint) {
+    part = p;
+    pos = at = sizeof(ImgHeader);
+    if (part) return true;
+    cap = sizeof(ImgHeader) + hint;
+    heap = imgAlloc(cap);
+    if (!heap) err = String("no memory for a ") + (unsigned)cap + "-byte arena";
+    return heap != nullptr;
+  }
+  void abandon() {
+    free(heap);
+    heap = nullptr;
+  }
+  bool flush() {
+    if (!staged) return true;
+    if (at + staged > part->size) {
+      err = ERR_PARTITION_FULL;
+      return false;
+    }
+    while (erased < at + staged) {
+      if (esp_partition_erase_range(part, erased, 4096) != ESP_OK) {
+        err = "cannot erase model partition";
+        return false;
+      }
+      erased += 4096;
+    }
+    if (esp_partition_write(part, at, stage, staged) != ESP_OK) {
+      err = "model partition write failed";
+      return false;
+    }
+    at += staged;
+    staged = 0;
+    return true;
+  }
+  bool put(const void *src, size_t n) {
+    const uint8_t *b = (const uint8_t *)src;
+    if (heap) {
+      if (pos + n > cap) {
+        size_t grow = cap + cap / 2 > pos + n ? cap + cap / 2 : pos + n;
+        uint8_t *p = imgRealloc(heap, grow);
+        if (!p) {
+          err = String("no memory to grow the arena to ") + (unsigned)grow;
+          return false;
+        }
+        heap = p;
+        cap = grow;
+      }
+      memcpy(heap + pos, b, n);
+      pos += n;
+      return true;
+    }
+    while (n) {
+      size_t c = sizeof(stage) - staged < n ? sizeof(stage) - staged : n;
+      memcpy(stage + staged, b, c);
+      staged += c;
+      b += c;
+      n -= c;
+      pos += c;
+      if (staged == sizeof(stage) && !flush()) return false;
+    }
+    return true;
+  }
+  // Appends a string to the blob; returns its blob offset.
+  uint32_t putStr(const char *s, size_t n, bool &ok) {
+    uint32_t off = pos - sizeof(ImgHeader);
+    ok = ok && put(s, n + 1);
+    return off;
+  }
+  bool zeroTo(size_t end) {
+    static const uint8_t zero[16] = {0};
+    while (pos < end)
+      if (!put(zero, end - pos < sizeof(zero) ? end - pos : sizeof(zero)))
+        return false;
+    return true;
+  }
+
+  uint32_t keyword(const char *s, size_t n) {
+    if (kwOff.size() * 2 >= slots.size()) {
+      slots.assign(slots.empty() ? 64 : slots.size() * 2, 0);
+      for (uint32_t id = 0; id < kwOff.size(); id++) {
+        const char *t = kwText.data() + kwOff[id];
+        uint32_t i = fnv1a(FNV_SEED, (const uint8_t *)t, strlen(t));
+        while (slots[i & (slots.size() - 1)]) i++;
+        slots[i & (slots.size() - 1)] = id + 1;
+      }
+    }
+    uint32_t i = fnv1a(FNV_SEED, (const uint8_t *)s, n);
+    for (;; i++) {
+      uint32_t &slot = slots[i & (slots.size() - 1)];
+      if (!slot) break;
+      const char *t = kwText.data() + kwOff[slot - 1];
+      if (!strncmp(t, s, n) && !t[n]) return slot - 1;
+    }
+    uint32_t id = kwOff.size();
+    kwOff.push_back(kwText.size());
+    kwText.insert(kwText.end(), s, s + n);
+    kwText.push_back(0);
+    slots[i & (slots.size() - 1)] = id + 1;
+    return id;
+  }
+
+  bool add(const ModelEntry &e) {
+    if (!entryFits(e, title.size(), err)) return false;
+    bool ok = true;
+    title.push_back(putStr(e.t.c_str(), e.t.length(), ok));
+    answer.push_back(lazy ? e.aAt : putStr(e.a.c_str(), e.a.length(), ok));
+    ansRaw.push_back(lazy ? e.aRaw : 0);
+    kw0.push_back(fwdKw.size());
+    for (auto &kv : e.k) {
+      fwdKw.push_back(keyword(kv.first.c_str(), kv.first.length()));
+      fwdW.push_back(kv.second);
+    }
+    if (kwOff.size() > 65535) {
+      err = "too many distinct keywords (max 65535)";
+      return false;
+    }
+    return ok;
+  }
+
+  template <typename T>
+  bool putArray(const std::vector<T> &v) {
+    return v.empty() || put(v.data(), v.size() * sizeof(T));
+  }
+
+  bool finish(const ToonPack &hdr, uint32_t srcHash, uint32_t srcSize,
+              Model &m) {
+    uint32_t n = title.size(), k = kwOff.size(), p = fwdKw.size();
+    kw0.push_back(p);
+
+    // dictionary in byte order; rank[] maps build ids to final ids
+    std::vector<uint32_t> order(k), rank(k), kwStr(k), kwPost(k + 1, 0);
+    std::vector<uint8_t> kwLen(k);
+    for (uint32_t i = 0; i < k; i++) order[i] = i;
+    std::sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) {
+      return strcmp(kwText.data() + kwOff[a], kwText.data() + kwOff[b]) < 0;
+    });
+    bool ok = true;
+    for (uint32_t r = 0; r < k; r++) {
+      const char *t = kwText.data() + kwOff[order[r]];
+      rank[order[r]] = r;
+      kwLen[r] = strlen(t);
+      kwStr[r] = putStr(t, kwLen[r], ok);
+    }
+    ImgHeader h = {};
+    h.name = putStr(hdr.name.c_str(), hdr.name.length(), ok);
+    h.author = putStr(hdr.author.c_str(), hdr.author.length(), ok);
+    h.desc = putStr(hdr.desc.c_str(), hdr.desc.length(), ok);
+    if (!ok) return false;
+    std::vector<char>().swap(kwText);
+    std::vector<uint32_t>().swap(slots);
+
+    // invert: counting sort by keyword keeps each postings list in
+    // entry order, so ties rank like a scan in file order
+    std::vector<uint16_t> entKw(p), postEntry(p);
+    std::vector<uint8_t> postW(p);
+    for (uint32_t j = 0; j < p; j++) kwPost[rank[fwdKw[j]] + 1]++;
+    for (uint32_t r = 0; r < k; r++) kwPost[r + 1] += kwPost[r];
+    std::vector<uint32_t> cursor(kwPost.begin(), kwPost.end() - 1);
+    for (uint32_t e = 0; e < n; e++) {
+      for (uint32_t j = kw0[e]; j < kw0[e + 1]; j++) {
+        uint32_t r = rank[fwdKw[j]];
+        entKw[j] = r;
+        postEntry[cursor[r]] = e;
+        postW[cursor[r]++] = fwdW[j];
+      }
+    }
+
+    h.magic = IMG_MAGIC;
+    h.format = IMG_FORMAT;
+    h.headerSize = sizeof(ImgHeader);
+    h.flags = lazy ? IMG_LAZY_ANSWERS : 0;
+    h.srcHash = srcHash;
+    h.srcSize = srcSize;
+    h.version = hdr.version;
+    h.threshold = hdr.threshold;
+    h.temperature = hdr.temperature;
+    h.nEntries = n;
+    h.nKeywords = k;
+    h.nPostings = p;
+    h.stringsSize = pos - sizeof(ImgHeader);
+    ImgLayout L = imgLayout(n, k, p, h.stringsSize);
+    h.size = L.size;
+    if (!zeroTo(L.entTitle) || !putArray(title) || !putArray(answer) ||
+        !putArray(kw0) || !putArray(kwStr) || !putArray(kwPost) ||
+        !putArray(ansRaw) || !putArray(entKw) || !putArray(postEntry) ||
+        !putArray(kwLen) || !putArray(fwdW) || !putArray(postW) ||
+        !zeroTo(L.size))
+      return false;
+
+    if (heap) {
+      memcpy(heap, &h, sizeof(h));
+      if (cap > L.size) {
+        uint8_t *shrunk = imgRealloc(heap, L.size);
+        if (shrunk) heap = shrunk;
+      }
+      m.arena = heap;
+      heap = nullptr;
+      return attachImage(m, m.arena, L.size, err);
+    }
+    if (!flush()) return false;
+    if (esp_partition_write(part, 0, &h, sizeof(h)) != ESP_OK) {
+      err = "model partition write failed";
+      return false;
+    }
+    return mapModelPartition(m, part, err);
+  }
+};
+
+// The one load path for files and uploads: ToonParser streams entries
+// straight into a ModelBuilder (part = null builds into heap). A heap
+// arena built from the model file leaves the answers there (lazy): they
+// are most of a pack, and a query needs one.
+static bool buildModel(PackFile &src, uint32_t srcHash, uint32_t srcSize,
+                       const esp_partition_t *part, Model &m, String &err,
+                       int &line) {
+  ToonPack hdr;
+  ModelBuilder *b = new ModelBuilder();
+  ToonParser *tp = new ToonParser();
+  line = 0;
+  b->lazy = !src.mem && !part;
+  bool ok = b->begin(part, (b->lazy ? srcSize / 4 : srcSize) + 256);
+  if (ok) {
+    tp->begin(hdr, [tp, b](ModelEntry &e) {
+      if (b->add(e)) return true;
+      tp->fail(b->err, tp->lineNo);
+      return false;
+    });
+    ok = feedToon(*tp, src);
+    if (!ok) {
+      err = tp->err;
+      line = tp->errLine;
+    } else if (!(ok = b->finish(hdr, srcHash, srcSize, m))) {
+      err = b->err;
+    }
+  } else {
+    err = b->err;
+  }
+  if (!ok) b->abandon();
+  delete tp;
+  delete b;
+  return ok;
+}
+
+// Compile the TOON file at path into m. If the partition already holds an
+// image of this exact file (hash + size), map it — a header check, no
+// parse. Otherwise parse and compile once: into the partition, or into
+// heap (answers left in the file) without one or when it is full.
+static bool compileModel(const String &path, const esp_partition_t *part,
+                         Model &m) {
+  PackFile f;
+  if (!f.open(path.c_str())) {
+    Serial.printf("[model] ERROR: model file %s missing or corrupt\n",
+                  path.c_str());
+    return false;
+  }
+  uint32_t srcSize = f.size, srcHash = hashPack(f);
+  String err;
+  if (part && mapModelPartition(m, part, err)) {
+    if (m.img->srcHash == srcHash && m.img->srcSize == srcSize) {
+      f.close();
+      m.src = path;
+      Serial.printf("[model] mapped \"%s\" v%d from flash — %u entries, %u "
+                    "keywords, image %u bytes (no parse)\n",
+                    m.name, m.version, (unsigned)m.nEntries,
+                    (unsigned)m.nKeywords, (unsigned)m.img->size);
+      return true;
+    }
+    releaseModel(m);
+    Serial.println("[model] flash image is stale — recompiling");
+  }
+
+  int line = 0;
+  bool built = buildModel(f, srcHash, srcSize, part, m, err, line);
+  if (!built && part && err == ERR_PARTITION_FULL) {
+    Serial.println("[model] too big for the aura_model partition — "
+                   "building in heap");
+    f.seek(0);
+    built = buildModel(f, srcHash, srcSize, nullptr, m, err, line);
+  }
+  f.close();
+  if (!built) {
+    if (line)
+      Serial.printf("[model] ERROR: %s (line %d)\n", err.c_str(), line);
+    else
+      Serial.printf("[model] ERROR: %s\n", err.c_str());
+    return false;
+  }
+  m.src = path;
+  Serial.printf("[model] compiled \"%s\" v%d — %u entries, %u keywords, "
+                "image %u bytes in %s, heap %u KB free\n",
+                m.name, m.version, (unsigned)m.nEntries,
+                (unsigned)m.nKeywords, (unsigned)m.img->size,
+                m.mapped ? "flash" : "heap",
+                (unsigned)(ESP.getFreeHeap() / 1024));
+  return true;
+}
+
+// Every pack file: MODEL_PATH, then MODELS_DIR/*.toon by name.
+static std::vector<String> packPaths() {
+  std::vector<String> paths;
+  if (LittleFS.exists(MODEL_PATH)) paths.push_back(MODEL_PATH);
+  File dir = LittleFS.open(MODELS_DIR);
+  if (!dir || !dir.isDirectory()) return paths;
+  size_t first = paths.size();
+  for (File f = dir.openNextFile(); f; f = dir.openNextFile()) {
+    String name = f.name();  // a bare name or a full path, by core version
+    name = name.substring(name.lastIndexOf('/') + 1);
+    if (!f.isDirectory() && name.endsWith(".toon"))
+      paths.push_back(String(MODELS_DIR) + "/" + name);
+  }
+  std::sort(paths.begin() + first, paths.end(),
+            [](const String &a, const String &b) {
+              return strcmp(a.c_str(), b.c_str()) < 0;
+            });
+  return paths;
+}
+
+// Boot path: (re)load every pack. MODEL_PATH may use the partition, the
+// rest live in heap. Nothing may still map the partition while it is
+// rewritten, so the old set goes first. Retired pack files a reset left
+// behind are cleared.
+static void loadModels() {
+  modelsPublish(new ModelSet());
+  std::vector<String> stale;
+  File dir = LittleFS.open(MODEL_RETIRED_DIR);
+  if (dir && dir.isDirectory())
+    for (File f = dir.openNextFile(); f; f = dir.openNextFile()) {
+      String name = f.name();
+      stale.push_back(String(MODEL_RETIRED_DIR) + "/" +
+                      name.substring(name.lastIndexOf('/') + 1));
+    }
+  for (const String &p : stale) LittleFS.remove(p.c_str());
+  ModelSet *s = new ModelSet();
+  const esp_partition_t *part = modelPartition();
+  for (const String &path : packPaths()) {
+    Model *m = new Model();
+    if (compileModel(path, path == MODEL_PATH ? part : nullptr, *m))
+      s->packs.push_back(m);
+    else
+      modelRelease(m);
+  }
+  modelsPublish(s);
+}
+
+// A prompt word: a NUL-terminated view into a Tokens buffer.
+struct Token {
+  const char *s;
+  uint16_t n;
+  bool is(const char *w) const { return strcmp(s, w) == 0; }
+  bool startsWith(const char *w) const {
+    return strncmp(s, w, strlen(w)) == 0;
+  }
+  long num() const { return atol(s); }
+};
+
+// One tokenization pass per prompt: lowercase alphanumeric words copied
+// into a fixed buffer. The primary and knowledge models read the same set,
+// and nothing on the way allocates. Words past MAX or past the buffer are
+// dropped.
+struct Tokens {
+  static const int MAX = 24;
+  char buf[384];
+  Token t[MAX];
+  int n = 0;
+  const Token &operator[](int i) const { return t[i]; }
+};
+
+static void tokenizePrompt(const char *p, size_t len, Tokens &ts) {
+  size_t w = 0;
+  ts.n = 0;
+  for (size_t i = 0; i < len && ts.n < Tokens::MAX;) {
+    if (!isalnum((unsigned char)p[i])) {
+      i++;
+      continue;
+    }
+    size_t b = w;
+    while (i < len && isalnum((unsigned char)p[i]) && w + 1 < sizeof(ts.buf))
+      ts.buf[w++] = tolower((unsigned char)p[i++]);
+    if (i < len && isalnum((unsigned char)p[i])) break;  // buffer full
+    ts.buf[w++] = 0;
+    ts.t[ts.n++] = {ts.buf + b, (uint16_t)(w - 1 - b)};
+  }
+}
+
+static void tokenizePrompt(const String &p, Tokens &ts) {
+  tokenizePrompt(p.c_str(), p.length(), ts);
+}
+
+// Heap allocations seen by the ESP-IDF heap hooks (CONFIG_HEAP_USE_HOOKS);
+// `bench prompt` reads it around the tokenize + score path.
+static volatile uint32_t gAllocs = 0;
+#ifdef CONFIG_HEAP_USE_HOOKS
+static const bool kAllocHooks = true;
+extern "C" void esp_heap_trace_alloc_hook(void *, size_t, uint32_t) {
+  gAllocs++;
+}
+extern "C" void esp_heap_trace_free_hook(void *) {}
+#else
+static const bool kAllocHooks = false;
+#endif
+
+static bool tokenMatches(const Token &tok, const char *key, size_t kl) {
+  size_t tl = tok.n;
+  const char *t = tok.s;
+  if (tl == kl) return memcmp(t, key, kl) == 0;
+  // light stemming: prefix match for words of 4+ chars
+  if (kl >= 4 && tl > kl) return memcmp(t, key, kl) == 0;
+  if (tl >= 4 && kl > tl) return memcmp(t, key, tl) == 0;
+  return false;
+}
+
+// Compare keyword k against the n-char span s, strcmp-style.
+static int kwCompare(const Model &m, uint32_t k, const char *s, size_t n) {
+  size_t kl = m.kwLen[k];
+  int c = memcmp(m.str + m.kwStr[k], s, kl < n ? kl : n);
+  if (c) return c;
+  return kl < n ? -1 : (kl > n ? 1 : 0);
+}
+
+static uint32_t kwLowerBound(const Model &m, const char *s, size_t n) {
+  uint32_t lo = 0, hi = m.nKeywords;
+  while (lo < hi) {
+    uint32_t mid = (lo + hi) / 2;
+    if (kwCompare(m, mid, s, n) < 0)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+// Append the ids of every keyword tokenMatches() would accept for tok.
+static void matchKeywords(const Model &m, const Token &tok,
+                          std::vector<uint32_t> &out) {
+  const char *s = tok.s;
+  size_t tl = tok.n;
+  uint32_t n = m.nKeywords;
+  // exact match, then (4+ chars) every keyword the token is a stem of —
+  // all of them sort contiguously right after the token itself
+  uint32_t i = kwLowerBound(m, s, tl);
+  if (i < n && kwCompare(m, i, s, tl) == 0) out.push_back(i++);
+  if (tl >= 4)
+    for (; i < n && m.kwLen[i] > tl && memcmp(m.str + m.kwStr[i], s, tl) == 0;
+         i++)
+      out.push_back(i);
+  // keywords of 4+ chars that are a stem of the token: one probe per length
+  for (size_t l = 4; l < tl; l++) {
+    uint32_t j = kwLowerBound(m, s, l);
+    if (j < n && kwCompare(m, j, s, l) == 0) out.push_back(j);
+  }
+}
+
+struct Ranking {
+  int best = -1, second = -1;
+  int bestScore = 0, secondScore = 0;
+  int pack = 0;  // index into ModelSet::packs
+};
+
+// Same best/second rule as a linear scan over entries in file order.
+static void rankEntry(Ranking &r, int entry, int score) {
+  if (score > r.bestScore) {
+    r.secondScore = r.bestScore;
+    r.second = r.best;
+    r.bestScore = score;
+    r.best = entry;
+  } else if (score > r.secondScore) {
+    r.secondScore = score;
+    r.second = entry;
+  }
+}
+
+// Score through the inverted index: only postings of keywords some prompt
+// token hits are touched. Each keyword counts once per entry.
+static Ranking rankEntries(Model &m, const Token *toks, int nTok) {
+  std::vector<uint32_t> &hit = m.hit;
+  hit.clear();
+  for (int i = 0; i < nTok; i++) matchKeywords(m, toks[i], hit);
+  std::sort(hit.begin(), hit.end());
+  hit.erase(std::unique(hit.begin(), hit.end()), hit.end());
+
+  for (uint32_t k : hit) {
+    for (uint32_t p = m.kwPost[k]; p < m.kwPost[k + 1]; p++) {
+      uint16_t e = m.postEntry[p];
+      if (m.score[e] == 0) m.touched.push_back(e);
+      m.score[e] += m.postW[p];
+    }
+  }
+  std::sort(m.touched.begin(), m.touched.end());
+  m.touched.erase(std::unique(m.touched.begin(), m.touched.end()),
+                  m.touched.end());
+
+  Ranking r;
+  for (uint32_t e : m.touched) {
+    rankEntry(r, e, m.score[e]);
+    m.score[e] = 0;
+  }
+  m.touched.clear();
+  return r;
+}
+
+// Upper bound of any entry's score in m for these words, from the keyword
+// signature: words sharing a signature key count once — a keyword scores
+// once however many words hit it. A pack whose bound is below its
+// threshold cannot answer.
+static uint32_t packReach(const Model &m, const Token *toks, int nTok) {
+  uint32_t seen[Tokens::MAX], mask = m.sig.size() - 1, reach = 0;
+  int nSeen = 0;
+  for (int i = 0; i < nTok; i++) {
+    uint32_t h = sigHash(toks[i].s, toks[i].n);
+    if (std::find(seen, seen + nSeen, h) != seen + nSeen) continue;
+    if (nSeen < Tokens::MAX) seen[nSeen++] = h;
+    uint16_t a = m.sig[h & mask], b = m.sig[(h >> 16) & mask];
+    reach += a < b ? a : b;
+  }
+  return reach;
+}
+
+// Rank every pack that can reach its threshold. The answer comes from the
+// pack with the highest best score at or above its own threshold, ties to
+// the earlier pack; when none answers, the highest score is kept for the
+// log.
+static Ranking rankModels(ModelSet &s, const Token *toks, int nTok) {
+  Ranking out;
+  bool answers = false;
+  for (int i = 0; i < (int)s.packs.size(); i++) {
+    Model &m = *s.packs[i];
+    uint32_t reach = packReach(m, toks, nTok);
+    if (!reach || (int)reach < m.threshold) continue;
+    Ranking r = rankEntries(m, toks, nTok);
+    r.pack = i;
+    bool a = r.best >= 0 && r.bestScore >= m.threshold;
+    if (a > answers || (a == answers && r.bestScore > out.bestScore)) {
+      out = r;
+      answers = a;
+    }
+  }
+  return out;
+}
+
+// Reference scorer over the forward tables: every entry x keyword x
+// token. Kept for `bench model`.
+static Ranking rankEntriesLinear(const Model &m, const Token *toks,
+                                 int nTok) {
+  Ranking r;
+  for (uint32_t e = 0; e < m.nEntries; e++) {
+    int score = 0;
+    for (uint32_t j = m.entKw0[e]; j < m.entKw0[e + 1]; j++) {
+      uint16_t k = m.entKw[j];
+      for (int i = 0; i < nTok; i++) {
+        if (tokenMatches(toks[i], m.str + m.kwStr[k], m.kwLen[k])) {
+          score += m.entW[j];
+          break;  // each keyword counts once
+        }
+      }
+    }
+    rankEntry(r, e, score);
+  }
+  return r;
+}
+
+// Prompt cache: the knowledge model's ranking for recently seen prompts,
+// keyed on the normalized token sequence and the pack set's hash.
+// Rankings, not replies, are kept, so temperature still varies the
+// wording on a replay. Only prompts the primary model passed on are
+// stored — hardware prompts never reach it — and only those a pack
+// answers: a decline is no cheaper to replay than to rank again.
+struct PromptCache {
+  static const int SLOTS = 16, KEY = 96;
+  struct Slot {
+    uint32_t used = 0;  // LRU tick, 0 = empty
+    uint32_t hash = 0, model = 0;
+    uint16_t len = 0;
+    char key[KEY];
+    Ranking r;
+  };
+  Slot slot[SLOTS];
+  uint32_t tick = 0, hits = 0, misses = 0;
+};
+static PromptCache gPromptCache;
+
+// Tokens joined by single spaces; 0 if there are none or they don't fit.
+static size_t promptKey(const Tokens &ts, char *key) {
+  size_t n = 0;
+  for (int i = 0; i < ts.n; i++) {
+    if (n + ts[i].n + 1 > PromptCache::KEY) return 0;
+    if (i) key[n++] = ' ';
+    memcpy(key + n, ts[i].s, ts[i].n);
+    n += ts[i].n;
+  }
+  return n;
+}
+
+static PromptCache::Slot *promptCacheFind(const ModelSet &ms,
+                                          const char *key, size_t n,
+                                          uint32_t hash) {
+  for (auto &s : gPromptCache.slot)
+    if (s.used && s.hash == hash && s.len == n && s.model == ms.hash &&
+        !memcmp(s.key, key, n))
+      return &s;
+  return nullptr;
+}
+
+// Replay a cached ranking for ts into r; true on a hit.
+static bool promptCacheGet(const ModelSet &ms, const Tokens &ts,
+                           Ranking &r) {
+  char key[PromptCache::KEY];
+  size_t n = promptKey(ts, key);
+  if (!n || ms.packs.empty()) return false;
+  PromptCache::Slot *s =
+      promptCacheFind(ms, key, n, fnv1a(FNV_SEED, (const uint8_t *)key, n));
+  if (!s) return false;
+  s->used = ++gPromptCache.tick;
+  gPromptCache.hits++;
+  r = s->r;
+  return true;
+}
+
+static void promptCachePut(const ModelSet &ms, const Tokens &ts,
+                           const Ranking &r) {
+  char key[PromptCache::KEY];
+  size_t n = promptKey(ts, key);
+  if (!n) return;
+  gPromptCache.misses++;
+  uint32_t hash = fnv1a(FNV_SEED, (const uint8_t *)key, n);
+  PromptCache::Slot *s = promptCacheFind(ms, key, n, hash);
+  if (!s) {
+    s = &gPromptCache.slot[0];
+    for (auto &c : gPromptCache.slot)
+      if (c.used < s->used) s = &c;
+  }
+  s->used = ++gPromptCache.tick;
+  s->hash = hash;
+  s->model = ms.hash;
+  s->len = n;
+  memcpy(s->key, key, n);
+  s->r = r;
+}
+
+// Titles are served in place — pointers into the arena. So are answers,
+// unless the model is lazy: then the answer cell is read back from the
+// TOON file and decoded exactly as the parser would, through a small LRU;
+// from a TZ1 file that decodes the block holding it. The pointer stays
+// valid until the next modelAnswer() call.
+// An install moves the file a heap model was built from and repoints src
+// under gModelLock, so src is only read under it; an open File survives
+// the move.
+static bool openModelSource(const Model &m, PackFile &f) {
+  std::lock_guard<std::mutex> g(gModelLock);
+  return f.open(m.src.c_str());
+}
+
+static const char *modelTitle(const Model &m, uint32_t i) {
+  return m.str + m.entTitle[i];
+}
+
+static const char *modelAnswer(Model &m, uint32_t i) {
+  if (!m.lazy) return m.str + m.entAnswer[i];
+  AnswerCache &c = m.answers;
+  int slot = 0;
+  for (int s = 0; s < AnswerCache::SLOTS; s++) {
+    if (c.entry[s] == (int32_t)i) {
+      c.used[s] = ++c.tick;
+      c.hits++;
+      return c.text[s].c_str();
+    }
+    if (c.used[s] < c.used[slot]) slot = s;
+  }
+  c.misses++;
+  char cell[MAX_TOON_LINE + 1];
+  size_t n = m.entAnsRaw[i], at = 0;
+  PackFile f;
+  if (!openModelSource(m, f) || !f.seek(m.entAnswer[i]) ||
+      f.read((uint8_t *)cell, n) != n) {
+    Serial.printf("[model] ERROR: cannot read answer %u of \"%s\"\n",
+                  (unsigned)i, m.name);
+    f.close();
+    return "(answer unavailable — the model file cannot be read)";
+  }
+  f.close();
+  c.entry[slot] = i;
+  c.used[slot] = ++c.tick;
+  c.text[slot] = ToonParser::field(cell, n, at);
+  return c.text[slot].c_str();
+}
+
+static void addTopics(String &out, const Model &m) {
+  for (uint32_t i = 0; i < m.nEntries; i++) {
+    if (out.length()) out += ", ";
+    out += modelTitle(m, i);
+  }
+}
+
+// The first DECLINE_TOPICS titles across the packs, then a count of the
+// rest: a decline costs the same for a pack of ten entries or ten thousand.
+static String modelTopics(const ModelSet &s) {
+  String out;
+  uint32_t shown = 0, total = 0;
+  for (const Model *m : s.packs) {
+    total += m->nEntries;
+    for (uint32_t i = 0; i < m->nEntries && shown < DECLINE_TOPICS;
+         i++, shown++) {
+      if (out.length()) out += ", ";
+      out += modelTitle(*m, i);
+    }
+  }
+  if (total > shown)
+    out += String(" and ") + (int)(total - shown) +
+           " more (type `model` for the full list)";
+  return out;
+}
+
+// "automation v3", or "automation v3 + drives v1" with more packs.
+static String packNames(const ModelSet &s, bool versions) {
+  String out;
+  for (const Model *m : s.packs) {
+    if (out.length()) out += " + ";
+    out += m->name;
+    if (versions) out += String(" v") + m->version;
+  }
+  return out;
+}
+
+// "temperature" sampling: facts stay curated, presentation varies.
+static uint32_t rnd(uint32_t n) { return esp_random() % n; }
+static bool roll(float p) {
+  if (p <= 0.0f) return false;
+  return (esp_random() % 1000) < (uint32_t)(p * 1000.0f);
+}
+
+// Word the reply for a ranking: fresh, or replayed from the prompt cache.
+static String modelReply(ModelSet &s, const Ranking &r) {
+  Model &m = *s.packs[r.pack];
+  int bestScore = r.bestScore, secondScore = r.secondScore;
+
+  float T = m.temperature;
+  Serial.printf("[model] query scored %d (threshold %d, temperature %.1f)\n",
+                bestScore, m.threshold, T);
+
+  if (r.best < 0 || bestScore < m.threshold) {
+    switch (roll(T) ? rnd(3) : 0) {
       case 1:
-        return String("Hmm, that's outside my domain — \"") + gModel.name +
-               " v" + gModel.version +
+        return String("Hmm, that's outside my domain — \"") +
+               packNames(s, true) +
                "\" has nothing reliable on it, and I'd rather decline than "
-               "guess.\n\nAsk me about: " + modelTopics() + ".";
+               "guess.\n\nAsk me about: " + modelTopics(s) + ".";
       case 2:
         return String("I'd love to help, but my loaded model \"") +
-               gModel.name +
+               packNames(s, false) +
                "\" doesn't cover that — and a good professor never "
-               "improvises facts.\n\nTopics I do know: " + modelTopics() +
+               "improvises facts.\n\nTopics I do know: " + modelTopics(s) +
                ".\n\n(You can install another model in the Model panel "
                "below.)";
       default:
         return String("I must decline — my loaded knowledge model \"") +
-               gModel.name + " v" + gModel.version +
+               packNames(s, true) +
                "\" doesn't cover that topic.\n\nAsk me about: " +
-               modelTopics() +
+               modelTopics(s) +
                ".\n\n(Or install a different model in the Model panel below.)";
     }
   }
 
+  const char *title = modelTitle(m, r.best);
+  const char *answer = modelAnswer(m, r.best);
   String body;
   switch (roll(T) ? rnd(4) : 0) {
     case 1:
-      body = String("Let me explain ") + best->t + ".\n\n" + best->a;
+      body = String("Let me explain ") + title + ".\n\n" + answer;
       break;
     case 2:
-      body = best->a + "\n\n(topic: " + best->t + ")";
+      body = String(answer) + "\n\n(topic: " + title + ")";
       break;
     case 3:
-      body = String("Good question — this is about ") + best->t + ":\n\n" +
-             best->a;
+      body = String("Good question — this is about ") + title + ":\n\n" +
+             answer;
       break;
     default:
-      body = String("📚 ") + best->t + "\n\n" + best->a;
+      body = String("📚 ") + title + "\n\n" + answer;
   }
-  if (second && secondScore >= gModel.threshold && roll(T * 0.6f))
-    body += String("\n\nRelated topic in my model: ") + second->t +
-            " — ask me about it.";
+  if (r.second >= 0 && secondScore >= m.threshold && roll(T * 0.6f))
+    body += String("\n\nRelated topic in my model: ") +
+            modelTitle(m, r.second) + " — ask me about it.";
   switch (roll(T) ? rnd(3) : 0) {
     case 1:
-      body += String("\n\n— ") + gModel.name + " v" + gModel.version;
+      body += String("\n\n— ") + m.name + " v" + m.version;
       break;
     case 2:
       break;  // sometimes no footer at all
     default:
-      body += String("\n\n— ") + gModel.name + " model v" + gModel.version +
+      body += String("\n\n— ") + m.name + " model v" + m.version +
               ", score " + bestScore;
   }
   return body;
 }
 
-static String cmdModelInfo() {
-  String out = "PRIMARY model (built-in, irreplaceable): greetings + hardware "
-               "integration\n  GPIO / ADC / PWM / temperature / I2C — type "
-               "`hw`\n\n";
-  if (!gModel.ok) return out + "ADDITIONAL model: none loaded";
-  File f = LittleFS.open(MODEL_PATH, "r");
-  size_t sz = f ? f.size() : 0;
+static String askModel(ModelSet &s, const Tokens &ts) {
+  if (s.packs.empty())
+    return "No knowledge model is loaded — install one in the Model panel "
+           "below.";
+  Ranking r = rankModels(s, ts.t, ts.n);
+  if (r.best >= 0 && r.bestScore >= s.packs[r.pack]->threshold)
+    promptCachePut(s, ts, r);
+  return modelReply(s, r);
+}
+
+static String cmdModelInfo() {
+  LiveModels live;
+  String out = "PRIMARY model (built-in, irreplaceable): greetings + hardware "
+               "integration\n  GPIO / ADC / PWM / temperature / I2C — type "
+               "`hw`";
+  int n = live->packs.size();
+  if (!n) return out + "\n\nADDITIONAL model: none loaded";
+  for (int i = 0; i < n; i++) {
+    const Model &m = *live->packs[i];
+    PackFile f;
+    String sz = "unreadable";
+    if (openModelSource(m, f))
+      sz = String((int)f.size) + " bytes" +
+           (f.z ? String(" (TZ1, ") + (int)f.stored + " stored, " +
+                      String(f.size / (float)f.stored, 1) + "x)"
+                : String());
+    f.close();
+    String topics;
+    addTopics(topics, m);
+    char hash[9];
+    snprintf(hash, sizeof(hash), "%08x", (unsigned)m.img->srcHash);
+    out += String("\n\nADDITIONAL model") +
+           (n > 1 ? String(" ") + (i + 1) + "/" + n : String()) +
+           " (swappable): " + m.name + " v" + m.version + "\n  author: " +
+           m.author + "\n  " + m.desc + "\n  entries: " + (int)m.nEntries +
+           " | keywords: " + (int)m.nKeywords + " | TOON file: " + m.src +
+           ", " + sz + ", hash " + hash +
+           " | threshold: " + m.threshold +
+           "\n  model arena: " + (int)m.img->size + " bytes (" +
+           (int)m.img->stringsSize + " text, " +
+           (int)(m.img->size - m.img->stringsSize) + " tables, " +
+           String(m.img->size / (float)(m.nEntries ? m.nEntries : 1), 1) +
+           " B/entry) " +
+           (m.mapped ? "read in place from flash" : "in heap") +
+           ", signature " + (int)(m.sig.size() * 2) + " bytes" +
+           (m.lazy ? String("\n  answers: read on demand | LRU ") +
+                         m.answers.hits + " hits, " + m.answers.misses +
+                         " misses"
+                   : String()) +
+           "\n\ntopics: " + topics;
+  }
+  return out;
+}
+
+// ------------------------------------------------------ bench model --------
+// `bench model`: per-query latency of the inverted index vs the linear
+// reference scorer on generated packs of 100, 1k and 10k entries.
+
+static uint32_t benchRng(uint32_t &s) {  // xorshift32: fixed-seed, repeatable
+  s ^= s << 13;
+  s ^= s >> 17;
+  s ^= s << 5;
+  return s;
+}
+
+static String benchWord(uint32_t i) {
+  char b[16];
+  snprintf(b, sizeof(b), "kw%lu", (unsigned long)i);
+  return b;
+}
+
+// n entries of 4 keywords drawn from a vocabulary of n / 2 + 64 words,
+// built straight into a heap arena.
+static bool makeBenchModel(Model &m, int n, uint32_t seed, String &err) {
+  ToonPack hdr;
+  hdr.name = "bench";
+  ModelBuilder *b = new ModelBuilder();
+  bool ok = b->begin(nullptr, n * 16);
+  uint32_t vocab = n / 2 + 64;
+  for (int i = 0; ok && i < n; i++) {
+    ModelEntry e;
+    e.t = String("t") + i;
+    e.a = String("a") + i;
+    for (int k = 0; k < 4; k++)
+      e.k.push_back({benchWord(benchRng(seed) % vocab), 1 + (int)(k == 0)});
+    ok = b->add(e);
+  }
+  ok = ok && b->finish(hdr, 0, 0, m);
+  if (!ok) {
+    err = b->err;
+    b->abandon();
+  }
+  delete b;
+  return ok;
+}
+
+static String cmdBenchModel() {
+  const int sizes[] = {100, 1000, 10000};
+  const int kQueries = 64;
+  String out = "bench model — generated packs, 4 keywords/entry, " +
+               String(kQueries) + " queries of 3 tokens, seed 1\n"
+               "  entries  keywords  index µs/q  scan µs/q  agree\n";
+  for (int n : sizes) {
+    // arena ~40 B/entry, build state and a realloc peak on top
+    size_t need = (size_t)n * 120;
+    if (need + 32 * 1024 > ESP.getFreeHeap()) {
+      char b[96];
+      snprintf(b, sizeof(b), "  %7d  skipped — needs ~%u KB, %u KB free\n",
+               n, (unsigned)(need / 1024),
+               (unsigned)(ESP.getFreeHeap() / 1024));
+      out += b;
+      continue;
+    }
+    Model m;
+    String err;
+    if (!makeBenchModel(m, n, 1, err)) {  // heap: never the live model
+      out += String("  ") + n + "  " + err + "\n";
+      continue;
+    }
+    uint32_t vocab = n / 2 + 64, seed = 7;
+    std::vector<String> words(kQueries * 3);
+    std::vector<Token> q(kQueries * 3);
+    for (size_t i = 0; i < q.size(); i++) {
+      String &t = words[i];
+      t = benchWord(benchRng(seed) % (vocab + vocab / 4));  // ~20% misses
+      if (benchRng(seed) % 4 == 0) t += "s";  // exercise prefix stemming
+      q[i] = {t.c_str(), (uint16_t)t.length()};
+    }
+
+    int agree = 0;
+    volatile int sink = 0;  // keeps the pure reference scan from being elided
+    int64_t t0 = esp_timer_get_time();
+    for (int i = 0; i < kQueries; i++) rankEntries(m, &q[i * 3], 3);
+    int64_t tIdx = esp_timer_get_time() - t0;
+    t0 = esp_timer_get_time();
+    for (int i = 0; i < kQueries; i++)
+      sink = sink + rankEntriesLinear(m, &q[i * 3], 3).bestScore;
+    int64_t tLin = esp_timer_get_time() - t0;
+    for (int i = 0; i < kQueries; i++) {
+      Ranking a = rankEntries(m, &q[i * 3], 3);
+      Ranking b = rankEntriesLinear(m, &q[i * 3], 3);
+      if (a.best == b.best && a.bestScore == b.bestScore &&
+          a.second == b.second)
+        agree++;
+    }
+    char b[96];
+    snprintf(b, sizeof(b), "  %7d  %8u  %10.1f  %9.1f  %d/%d\n", n,
+             (unsigned)m.nKeywords, tIdx / (double)kQueries,
+             tLin / (double)kQueries, agree, kQueries);
+    out += b;
+    releaseModel(m);
+  }
+  return out;
+}
+
+// `bench parse`: peak heap and throughput of the whole-file reference
+// parser vs the streaming ToonParser on a generated 96 KB pack in LittleFS.
+
+static const char *BENCH_PACK_PATH = "/bench.toon";
+static uint32_t gHeapLow;
+
+static void heapSample() {
+  uint32_t f = ESP.getFreeHeap();
+  if (f < gHeapLow) gHeapLow = f;
+}
+
+// Rows of fixed length (50 seven-letter words per answer), so the entry
+// count for the header is known before writing.
+static int writeBenchPack(size_t target) {
+  static const char *words[] = {"machine", "control", "voltage", "current",
+                                "process", "station", "network", "digital",
+                                "systems", "sensors", "outputs", "signals",
+                                "program", "vehicle", "battery", "console"};
+  const size_t rowLen = 2 + 13 + 1 + 36 + 1 + 2 + 50 * 8 - 1 + 1;
+  int n = (target - 64) / rowLen;
+  File f = LittleFS.open(BENCH_PACK_PATH, "w");
+  if (!f) return 0;
+  f.printf("name: bench\nversion: 1\nthreshold: 2\nentries[%d]{t,k,a}:\n", n);
+  uint32_t seed = 1;
+  char row[rowLen + 8];
+  for (int i = 0; i < n; i++) {
+    int p = snprintf(row, sizeof(row),
+                     "  \"Topic %05d\",\"kw%05u:2 kw%05u kw%05u kw%05u\",\"", i,
+                     (unsigned)(benchRng(seed) % 99999),
+                     (unsigned)(benchRng(seed) % 99999),
+                     (unsigned)(benchRng(seed) % 99999),
+                     (unsigned)(benchRng(seed) % 99999));
+    for (int w = 0; w < 50; w++) {
+      memcpy(row + p, words[benchRng(seed) % 16], 7);
+      p += 7;
+      row[p++] = w < 49 ? ' ' : '"';
+    }
+    row[p++] = '\n';
+    f.write((const uint8_t *)row, p);
+  }
+  f.close();
+  return n;
+}
+
+// Streaming parse of the bench pack; arena = build a heap model arena
+// like loadModels does, else drop each entry as it arrives (install-time
+// validation).
+static bool benchStream(bool arena) {
+  PackFile f;
+  if (!f.open(BENCH_PACK_PATH)) return false;
+  ToonPack p;
+  ModelBuilder *b = new ModelBuilder();
+  ToonParser *tp = new ToonParser();
+  b->lazy = true;
+  bool ok = !arena || b->begin(nullptr, f.size / 4 + 256);
+  tp->begin(p, [tp, b, arena](ModelEntry &e) {
+    heapSample();
+    return !arena || b->add(e) || tp->fail(b->err, tp->lineNo);
+  });
+  ok = ok && feedToon(*tp, f);
+  heapSample();
+  Model m;
+  ok = ok && (!arena || b->finish(p, 0, 0, m));
+  heapSample();
+  if (!ok) b->abandon();
+  releaseModel(m);
+  delete tp;
+  delete b;
+  f.close();
+  return ok;
+}
+
+static String cmdBenchParse() {
+  int entries = writeBenchPack(BENCH_PACK_SIZE);
+  File f = LittleFS.open(BENCH_PACK_PATH, "r");
+  size_t size = f ? f.size() : 0;
   if (f) f.close();
-  return out + "ADDITIONAL model (swappable): " + gModel.name + " v" +
-         gModel.version + "\n  author: " + gModel.author + "\n  " +
-         gModel.desc + "\n  entries: " + (int)gModel.entries.size() +
-         " | TOON file: " + (int)sz + " bytes | threshold: " +
-         gModel.threshold + "\n\ntopics: " + modelTopics();
+  if (!entries || !size) return "bench parse: cannot write the bench pack";
+
+  const char *names[] = {"whole file (readString)  ",
+                         "streaming -> model arena",
+                         "streaming, validate only "};
+  char b[128];
+  snprintf(b, sizeof(b),
+           "bench parse — generated pack, %.1f KB, %d entries\n"
+           "  parser                     peak heap     time     MB/s\n",
+           size / 1024.0, entries);
+  String out = b;
+  for (int k = 0; k < 3; k++) {
+    uint32_t base = ESP.getFreeHeap();
+    gHeapLow = base;
+    bool ok;
+    int64_t t0 = esp_timer_get_time();
+    if (k == 0) {
+      File f = LittleFS.open(BENCH_PACK_PATH, "r");
+      String text = f.readString();
+      f.close();
+      heapSample();
+      ToonPack p;
+      String err;
+      ok = parseToonText(text, p, err);
+      heapSample();
+    } else {
+      ok = benchStream(k == 1);
+    }
+    int64_t us = esp_timer_get_time() - t0;
+    snprintf(b, sizeof(b), "  %s %7.1f KB %7.1f ms %7.2f%s\n", names[k],
+             (base - gHeapLow) / 1024.0, us / 1000.0,
+             us ? size / (double)us : 0.0, ok ? "" : "  (parse error!)");
+    out += b;
+  }
+  LittleFS.remove(BENCH_PACK_PATH);
+  return out;
 }
 
 // -------------------------------------------- PRIMARY model (built-in) ------
@@ -517,6 +3254,23 @@ static const uint8_t SAFE_PINS[] = {1,  2,  4,  5,  6,  7,  8,  9,  10,
 
 // 0 = untouched, 1 = output, 2 = input, 3 = pwm
 static uint8_t gPinMode[49] = {0};
+// Pins, gPinMode and the I2C bus are shared by the prompt commands and the
+// wasm host API, which runs on the wasm and schedule tasks.
+static std::mutex gHwLock;
+// The pins Wire runs on, -1 while the bus is down. Guarded by gHwLock.
+static int gI2cSda = -1, gI2cScl = -1;
+
+// Brings Wire up on sda/scl, moving it if it runs on other pins. The
+// caller holds gHwLock.
+static bool i2cBegin(int sda, int scl) {
+  if (gI2cSda == sda && gI2cScl == scl) return true;
+  if (gI2cSda >= 0) Wire.end();
+  gI2cSda = gI2cScl = -1;
+  if (!Wire.begin(sda, scl)) return false;
+  gI2cSda = sda;
+  gI2cScl = scl;
+  return true;
+}
 
 static bool pinAllowed(int p) {
   for (uint8_t sp : SAFE_PINS)
@@ -541,6 +3295,7 @@ static String readTemperature() {
 }
 
 static String cmdHw() {
+  std::lock_guard<std::mutex> g(gHwLock);
   String out = "⚙ PRIMARY hardware model (built-in)\n";
   out += String("chip temperature: ") + String(temperatureRead(), 1) + " °C\n";
   out += String("safe GPIOs: 1 2 4-18 21 38-42 47 48 (LED = ") + gCfg.ledPin +
@@ -558,16 +3313,20 @@ static String cmdHw() {
 }
 
 static String cmdI2cScan(int sda, int scl) {
+  std::lock_guard<std::mutex> g(gHwLock);
   if (sda >= 0 && scl >= 0) {
     if (!pinAllowed(sda) || !pinAllowed(scl))
       return "i2c: those pins are not in the safe list";
-    Wire.end();
-    Wire.begin(sda, scl);
+  } else if (gI2cSda >= 0) {
+    sda = gI2cSda;  // no pins given: the bus where it already runs
+    scl = gI2cScl;
   } else {
-    Wire.begin();
     sda = SDA;
     scl = SCL;
   }
+  if (!i2cBegin(sda, scl))
+    return String("i2c: could not start the bus on SDA=") + sda + " SCL=" +
+           scl;
   String found;
   int n = 0;
   for (uint8_t a = 0x08; a <= 0x77; a++) {
@@ -587,24 +3346,122 @@ static String cmdI2cScan(int sda, int scl) {
   return out;
 }
 
+// Primary-model vocabulary. One row per word: a new synonym or language is
+// one more row here. Words are looked up through a perfect hash whose seed
+// is searched for at compile time, so classifying a token is one hash and
+// one strcmp whatever the table size.
+enum LexRole : uint8_t {
+  LEX_NONE,
+  LEX_GREET,     // English greeting
+  LEX_GREET_ID,  // Indonesian greeting
+  LEX_HW,        // hardware overview, first word only
+  LEX_I2C,       // i2c scan, first word only
+  LEX_PIN,       // the next word is a pin number
+  LEX_LED,
+  LEX_ADC,
+  LEX_PWM,
+  LEX_TEMP,
+  LEX_ON,
+  LEX_OFF,
+  LEX_READ,
+  LEX_CHECK,     // asks for a live reading
+};
+
+struct LexWord {
+  const char *w;
+  LexRole role;
+};
+
+static constexpr LexWord LEXICON[] = {
+    {"hello", LEX_GREET},      {"hi", LEX_GREET},
+    {"hey", LEX_GREET},        {"halo", LEX_GREET_ID},
+    {"hai", LEX_GREET_ID},     {"hei", LEX_GREET_ID},
+    {"kabar", LEX_GREET_ID},   {"pagi", LEX_GREET_ID},
+    {"siang", LEX_GREET_ID},   {"sore", LEX_GREET_ID},
+    {"malam", LEX_GREET_ID},   {"hw", LEX_HW},
+    {"hardware", LEX_HW},      {"i2c", LEX_I2C},
+    {"pin", LEX_PIN},          {"gpio", LEX_PIN},
+    {"led", LEX_LED},          {"lampu", LEX_LED},
+    {"adc", LEX_ADC},          {"analog", LEX_ADC},
+    {"pwm", LEX_PWM},          {"temp", LEX_TEMP},
+    {"suhu", LEX_TEMP},        {"on", LEX_ON},
+    {"nyalakan", LEX_ON},      {"hidupkan", LEX_ON},
+    {"nyala", LEX_ON},         {"hidup", LEX_ON},
+    {"high", LEX_ON},          {"off", LEX_OFF},
+    {"matikan", LEX_OFF},      {"mati", LEX_OFF},
+    {"low", LEX_OFF},          {"read", LEX_READ},
+    {"baca", LEX_READ},        {"cek", LEX_CHECK},
+    {"check", LEX_CHECK},      {"berapa", LEX_CHECK},
+    {"coba", LEX_CHECK},       {"ukur", LEX_CHECK},
+    {"measure", LEX_CHECK},    {"skrg", LEX_CHECK},
+    {"sekarang", LEX_CHECK},   {"now", LEX_CHECK},
+};
+static constexpr size_t LEX_WORDS = sizeof(LEXICON) / sizeof(LEXICON[0]);
+static constexpr int LEX_BITS = 8;  // 256 slots; raise if the seed search
+                                    // hits the compiler's constexpr depth
+static_assert(LEX_WORDS < 255, "slot table stores word index + 1 in a u8");
+
+// FNV-1a from a seeded basis; the slot is the top LEX_BITS bits, which
+// are the ones a change of seed stirs.
+static constexpr uint32_t lexHash(const char *s, uint32_t h) {
+  return *s ? lexHash(s + 1, (h ^ (uint8_t)*s) * 16777619u) : h;
+}
+static constexpr uint32_t lexSlot(const char *s, uint32_t seed) {
+  return lexHash(s, 2166136261u ^ seed) >> (32 - LEX_BITS);
+}
+static constexpr bool lexClashWith(uint32_t seed, size_t i, size_t j) {
+  return j < LEX_WORDS &&
+         (lexSlot(LEXICON[i].w, seed) == lexSlot(LEXICON[j].w, seed) ||
+          lexClashWith(seed, i, j + 1));
+}
+static constexpr bool lexClash(uint32_t seed, size_t i) {
+  return i < LEX_WORDS &&
+         (lexClashWith(seed, i, i + 1) || lexClash(seed, i + 1));
+}
+static constexpr uint32_t lexSeed(uint32_t seed) {
+  return lexClash(seed, 0) ? lexSeed(seed + 1) : seed;
+}
+static constexpr uint32_t LEX_SEED = lexSeed(0);
+
+static constexpr uint8_t lexFind(uint32_t slot, size_t i) {
+  return i == LEX_WORDS ? 0
+         : lexSlot(LEXICON[i].w, LEX_SEED) == slot ? (uint8_t)(i + 1)
+                                                   : lexFind(slot, i + 1);
+}
+#define LEX_S4(k) lexFind(k, 0), lexFind(k + 1, 0), lexFind(k + 2, 0), \
+                  lexFind(k + 3, 0)
+#define LEX_S16(k) LEX_S4(k), LEX_S4(k + 4), LEX_S4(k + 8), LEX_S4(k + 12)
+#define LEX_S64(k) LEX_S16(k), LEX_S16(k + 16), LEX_S16(k + 32), \
+                   LEX_S16(k + 48)
+// slot -> word index + 1, 0 = empty
+static constexpr uint8_t LEX_TABLE[1 << LEX_BITS] = {
+    LEX_S64(0), LEX_S64(64), LEX_S64(128), LEX_S64(192)};
+#undef LEX_S4
+#undef LEX_S16
+#undef LEX_S64
+
+static LexRole lexRole(const Token &t) {
+  uint8_t i = LEX_TABLE[lexSlot(t.s, LEX_SEED)];
+  return i && !strcmp(LEXICON[i - 1].w, t.s) ? LEXICON[i - 1].role
+                                             : LEX_NONE;
+}
+
 // Returns non-empty reply if the prompt belongs to the primary model.
 // English and Indonesian are understood.
-static String tryPrimary(const String &p) {
-  String toks[24];
-  int n = tokenizePrompt(p, toks, 24);
+static String tryPrimary(const ModelSet &ms, const Tokens &toks) {
+  int n = toks.n;
   if (n == 0) return "";
 
   // --- greetings ---
   bool greet = false, indo = false;
   for (int i = 0; i < n && n <= 5; i++) {
-    String &t = toks[i];
-    if (t == "hello" || t == "hi" || t == "hey") greet = true;
-    if (t == "halo" || t == "hai" || t == "hei") { greet = true; indo = true; }
-    if (t == "kabar" || t == "pagi" || t == "siang" || t == "sore" ||
-        t == "malam") { greet = true; indo = true; }
+    LexRole r = lexRole(toks[i]);
+    if (r == LEX_GREET) greet = true;
+    if (r == LEX_GREET_ID) { greet = true; indo = true; }
   }
   if (greet) {
-    String kn = gModel.ok ? gModel.name : (indo ? "(kosong)" : "(none)");
+    String kn = ms.packs.size() ? packNames(ms, false)
+                                : String(indo ? "(kosong)" : "(none)");
     uint32_t v = rnd(3);
     if (indo) {
       if (v == 1)
@@ -639,12 +3496,13 @@ static String tryPrimary(const String &p) {
   }
 
   // --- hardware ---
-  if (toks[0] == "hw" || toks[0] == "hardware") return cmdHw();
-  if (toks[0] == "i2c") {
+  LexRole first = lexRole(toks[0]);
+  if (first == LEX_HW) return cmdHw();
+  if (first == LEX_I2C) {
     int sda = -1, scl = -1;
     if (n >= 4) {
-      sda = toks[2].toInt();
-      scl = toks[3].toInt();
+      sda = toks[2].num();
+      scl = toks[3].num();
     }
     return cmdI2cScan(sda, scl);
   }
@@ -655,37 +3513,47 @@ static String tryPrimary(const String &p) {
   bool actOn = false, actOff = false, actRead = false, actCheck = false;
 
   for (int i = 0; i < n; i++) {
-    String &t = toks[i];
-    if (t == "pin" || t == "gpio") {
-      if (i + 1 < n) pin = toks[i + 1].toInt();
-    } else if (t.startsWith("pin") && t.length() > 3 &&
-               isdigit((unsigned char)t[3])) {
-      pin = t.substring(3).toInt();
-    } else if (t.startsWith("gpio") && t.length() > 4 &&
-               isdigit((unsigned char)t[4])) {
-      pin = t.substring(4).toInt();
-    } else if (t == "led" || t == "lampu") {
-      isLed = true;
-    } else if (t == "adc" || t == "analog") {
-      isAdc = true;
-      if (i + 1 < n) pin = toks[i + 1].toInt();
-    } else if (t == "pwm") {
-      isPwm = true;
-      if (i + 1 < n) pin = toks[i + 1].toInt();
-      if (i + 2 < n) pwmVal = toks[i + 2].toInt();
-    } else if (t == "temp" || t == "suhu" || t.startsWith("temperatur")) {
-      isTemp = true;
-    } else if (t == "on" || t == "nyalakan" || t == "hidupkan" ||
-               t == "nyala" || t == "hidup" || t == "high") {
-      actOn = true;
-    } else if (t == "off" || t == "matikan" || t == "mati" || t == "low") {
-      actOff = true;
-    } else if (t == "read" || t == "baca") {
-      actRead = true;
-    } else if (t == "cek" || t == "check" || t == "berapa" || t == "coba" ||
-               t == "ukur" || t == "measure" || t == "skrg" ||
-               t == "sekarang" || t == "now") {
-      actCheck = true;
+    const Token &t = toks[i];
+    switch (lexRole(t)) {
+      case LEX_PIN:
+        if (i + 1 < n) pin = toks[i + 1].num();
+        break;
+      case LEX_LED:
+        isLed = true;
+        break;
+      case LEX_ADC:
+        isAdc = true;
+        if (i + 1 < n) pin = toks[i + 1].num();
+        break;
+      case LEX_PWM:
+        isPwm = true;
+        if (i + 1 < n) pin = toks[i + 1].num();
+        if (i + 2 < n) pwmVal = toks[i + 2].num();
+        break;
+      case LEX_TEMP:
+        isTemp = true;
+        break;
+      case LEX_ON:
+        actOn = true;
+        break;
+      case LEX_OFF:
+        actOff = true;
+        break;
+      case LEX_READ:
+        actRead = true;
+        break;
+      case LEX_CHECK:
+        actCheck = true;
+        break;
+      default:
+        // shapes rather than words: pin5 / gpio5, temperature(s)
+        if (t.startsWith("pin") && t.n > 3 && isdigit((unsigned char)t.s[3]))
+          pin = atol(t.s + 3);
+        else if (t.startsWith("gpio") && t.n > 4 &&
+                 isdigit((unsigned char)t.s[4]))
+          pin = atol(t.s + 4);
+        else if (t.startsWith("temperatur"))
+          isTemp = true;
     }
   }
 
@@ -693,6 +3561,8 @@ static String tryPrimary(const String &p) {
   // ("what is a temperature sensor") fall through to the knowledge model.
   if (isTemp && (actCheck || actRead || n <= 2)) return readTemperature();
 
+  std::lock_guard<std::mutex> g(gHwLock);
+
   if (isAdc) {
     if (pin < 1 || pin > 10)
       return "⚙ adc: analog sensors go on GPIO 1-10 (ADC1) — e.g. `adc 4`. "
@@ -733,28 +3603,1148 @@ static String tryPrimary(const String &p) {
                 ? "\n(onboard LED; some boards wire it inverted)"
                 : "");
   }
-  // no explicit action: report pin state (reads a wired digital sensor)
-  if (gPinMode[pin] == 0) {
-    pinMode(pin, INPUT);
-    gPinMode[pin] = 2;
+  // no explicit action: report pin state (reads a wired digital sensor)
+  if (gPinMode[pin] == 0) {
+    pinMode(pin, INPUT);
+    gPinMode[pin] = 2;
+  }
+  return String("⚙ ") + pinStateStr(pin) +
+         (gPinMode[pin] == 2 ? "  (floating unless something is wired)" : "");
+}
+
+// ---------------------------------------------------- wasm host API -------
+// What a module may import from "aura" — the drivers' view of the board.
+// The calls are plain functions so the host bench drives them against its
+// simulated pins and I2C bus; the wasm3 bindings below only unpack
+// arguments. Pins obey SAFE_PINS like the prompt commands. A negative
+// result is a HostErr. The batched calls (i2c_write_read, adc_read_block)
+// move a whole register burst or sample block per interpreter crossing.
+enum HostErr : int32_t {
+  HOST_EPIN = -1,   // pin not in SAFE_PINS (adc: not ADC1, GPIO 1-10)
+  HOST_EARG = -2,   // address or length out of range
+  HOST_ENACK = -3,  // no I2C device answered
+  HOST_ETIME = -4,  // the call's time budget ran out; the bindings trap
+};
+static const uint32_t HOST_I2C_MAX = 128;  // bytes each way per call
+static const uint32_t HOST_ADC_MAX = 512;  // samples per block
+static const uint32_t HOST_DELAY_MAX = 100000;  // µs per delay_us call
+static const uint64_t HOST_ADC_SPAN_MAX = 1000000;  // µs per sample block
+
+static int32_t hostGpioWrite(int32_t pin, int32_t level) {
+  if (!pinAllowed(pin)) return HOST_EPIN;
+  std::lock_guard<std::mutex> g(gHwLock);
+  if (gPinMode[pin] != 1) {
+    pinMode(pin, OUTPUT);
+    gPinMode[pin] = 1;
+  }
+  digitalWrite(pin, level ? HIGH : LOW);
+  return 0;
+}
+
+static int32_t hostGpioRead(int32_t pin) {
+  if (!pinAllowed(pin)) return HOST_EPIN;
+  std::lock_guard<std::mutex> g(gHwLock);
+  if (gPinMode[pin] == 0) {
+    pinMode(pin, INPUT);
+    gPinMode[pin] = 2;
+  }
+  return digitalRead(pin) ? 1 : 0;
+}
+
+// Busy-waits like delayMicroseconds(); whole milliseconds yield instead.
+// Never waits past the running call's deadline: HOST_ETIME once it has
+// passed (a wait cut short by it returns 0, the next call fails).
+static int32_t hostDelayUs(uint32_t us) {
+  if (us > HOST_DELAY_MAX) us = HOST_DELAY_MAX;
+  int64_t now = esp_timer_get_time();
+  if (gWasmDeadline) {
+    if (now >= gWasmDeadline) return HOST_ETIME;
+    if (now + us > gWasmDeadline) us = gWasmDeadline - now;
+  }
+  if (us >= 2000) {
+    delay(us / 1000);
+    us %= 1000;
+  }
+  int64_t until = esp_timer_get_time() + us;
+  while (esp_timer_get_time() < until) {
+  }
+  return 0;
+}
+
+// Millivolts, as `adc` reports them. Takes gHwLock per sample, so a block
+// read never holds the pins across its waits.
+static int32_t hostAdcRead(int32_t pin) {
+  if (pin < 1 || pin > 10 || !pinAllowed(pin)) return HOST_EPIN;
+  std::lock_guard<std::mutex> g(gHwLock);
+  gPinMode[pin] = 2;
+  return analogReadMilliVolts(pin);
+}
+
+// n samples of pin, periodUs apart, into out as little-endian u16 mV.
+// The whole block spans at most HOST_ADC_SPAN_MAX.
+static int32_t hostAdcReadBlock(int32_t pin, uint8_t *out, uint32_t n,
+                                uint32_t periodUs) {
+  if (n > HOST_ADC_MAX || (uint64_t)n * periodUs > HOST_ADC_SPAN_MAX)
+    return HOST_EARG;
+  for (uint32_t i = 0; i < n; i++) {
+    if (gWasmDeadline && esp_timer_get_time() >= gWasmDeadline)
+      return HOST_ETIME;
+    int32_t mv = hostAdcRead(pin);
+    if (mv < 0) return mv;
+    out[2 * i] = mv & 0xff;
+    out[2 * i + 1] = mv >> 8;
+    if (periodUs && i + 1 < n && hostDelayUs(periodUs) == HOST_ETIME)
+      return HOST_ETIME;
+  }
+  return n;
+}
+
+// Write wn bytes then read rn with a repeated start — one register burst.
+// Either side may be empty. Returns the bytes read. Uses the bus where
+// `i2c scan` last put it, the board's SDA/SCL if nothing has started it.
+static int32_t hostI2cWriteRead(int32_t addr, const uint8_t *w, uint32_t wn,
+                                uint8_t *r, uint32_t rn) {
+  if (addr < 0x08 || addr > 0x77 || wn > HOST_I2C_MAX || rn > HOST_I2C_MAX)
+    return HOST_EARG;
+  std::lock_guard<std::mutex> g(gHwLock);
+  if (gI2cSda < 0 && !i2cBegin(SDA, SCL)) return HOST_ENACK;
+  if (wn) {
+    Wire.beginTransmission(addr);
+    Wire.write(w, wn);
+    if (Wire.endTransmission(rn == 0)) return HOST_ENACK;
+  }
+  if (!rn) return 0;
+  if (Wire.requestFrom((uint16_t)addr, (size_t)rn, true) != rn)
+    return HOST_ENACK;
+  for (uint32_t i = 0; i < rn; i++) r[i] = Wire.read();
+  return rn;
+}
+
+#ifndef AURA_HOST
+m3ApiRawFunction(m3GpioWrite) {
+  m3ApiReturnType(int32_t);
+  m3ApiGetArg(int32_t, pin);
+  m3ApiGetArg(int32_t, level);
+  m3ApiReturn(hostGpioWrite(pin, level));
+}
+
+m3ApiRawFunction(m3GpioRead) {
+  m3ApiReturnType(int32_t);
+  m3ApiGetArg(int32_t, pin);
+  m3ApiReturn(hostGpioRead(pin));
+}
+
+m3ApiRawFunction(m3AdcRead) {
+  m3ApiReturnType(int32_t);
+  m3ApiGetArg(int32_t, pin);
+  m3ApiReturn(hostAdcRead(pin));
+}
+
+m3ApiRawFunction(m3AdcReadBlock) {
+  m3ApiReturnType(int32_t);
+  m3ApiGetArg(int32_t, pin);
+  m3ApiGetArgMem(uint8_t *, out);
+  m3ApiGetArg(uint32_t, n);
+  m3ApiGetArg(uint32_t, periodUs);
+  if (n > HOST_ADC_MAX) m3ApiReturn(HOST_EARG);
+  m3ApiCheckMem(out, 2 * n);
+  int32_t got = hostAdcReadBlock(pin, out, n, periodUs);
+  if (got == HOST_ETIME) m3ApiTrap("time budget exceeded");
+  m3ApiReturn(got);
+}
+
+m3ApiRawFunction(m3I2cWriteRead) {
+  m3ApiReturnType(int32_t);
+  m3ApiGetArg(int32_t, addr);
+  m3ApiGetArgMem(const uint8_t *, w);
+  m3ApiGetArg(uint32_t, wn);
+  m3ApiGetArgMem(uint8_t *, r);
+  m3ApiGetArg(uint32_t, rn);
+  if (wn > HOST_I2C_MAX || rn > HOST_I2C_MAX) m3ApiReturn(HOST_EARG);
+  m3ApiCheckMem(w, wn);
+  m3ApiCheckMem(r, rn);
+  m3ApiReturn(hostI2cWriteRead(addr, w, wn, r, rn));
+}
+
+m3ApiRawFunction(m3DelayUs) {
+  m3ApiGetArg(uint32_t, us);
+  if (hostDelayUs(us) == HOST_ETIME) m3ApiTrap("time budget exceeded");
+  m3ApiSuccess();
+}
+
+m3ApiRawFunction(m3Millis) {
+  m3ApiReturnType(uint32_t);
+  m3ApiReturn((uint32_t)millis());
+}
+
+static const struct {
+  const char *name, *sig;
+  M3RawCall fn;
+} HOST_API[] = {
+    {"gpio_write", "i(ii)", m3GpioWrite},
+    {"gpio_read", "i(i)", m3GpioRead},
+    {"adc_read", "i(i)", m3AdcRead},
+    {"adc_read_block", "i(i*ii)", m3AdcReadBlock},
+    {"i2c_write_read", "i(i*i*i)", m3I2cWriteRead},
+    {"delay_us", "v(i)", m3DelayUs},
+    {"millis", "i()", m3Millis},
+};
+
+// A module imports any subset; the rest fail lookup, which is fine.
+static M3Result wasmLinkHost(IM3Module module) {
+  for (auto &h : HOST_API) {
+    M3Result res = m3_LinkRawFunction(module, "aura", h.name, h.sig, h.fn);
+    if (res && res != m3Err_functionLookupFailed) return res;
+  }
+  return m3Err_none;
+}
+#endif  // AURA_HOST
+
+// ---------------------------------------------------------- station ---------
+#ifndef AURA_HOST
+// The station link joins in the background: begin() brings up the AP and
+// the web server first, then loop() drives this state machine. WiFi events
+// only raise a flag; every WiFi.begin() happens here, after a backoff that
+// doubles per failed attempt up to STA_BACKOFF_MAX and is jittered so a
+// fleet rebooting together does not hammer the access point in step.
+static const uint32_t STA_JOIN_TIMEOUT = 15000;  // ms per attempt
+static const uint32_t STA_BACKOFF_MIN = 2000;
+static const uint32_t STA_BACKOFF_MAX = 60000;
+
+enum StaState : uint8_t { STA_OFF, STA_JOINING, STA_UP, STA_BACKOFF };
+
+struct StaLink {
+  StaState state = STA_OFF;
+  uint32_t at = 0;    // millis() the current state began
+  uint32_t wait = 0;  // STA_BACKOFF: delay before the next attempt
+  uint16_t fails = 0;  // failed attempts since the link was last up
+  uint32_t upAt = 0;   // millis() of the first successful join
+  std::atomic<bool> dropped{false};  // set by the disconnect event
+};
+static StaLink gSta;
+
+static void staJoin() {
+  gSta.dropped = false;
+  gSta.state = STA_JOINING;
+  gSta.at = millis();
+  WiFi.begin(gCfg.ssid, gCfg.pass);
+  Serial.printf("[wifi] joining \"%s\" (attempt %u)\n", gCfg.ssid,
+                (unsigned)gSta.fails + 1);
+}
+
+static void staBackoff() {
+  uint32_t base = STA_BACKOFF_MIN << (gSta.fails < 5 ? gSta.fails : 5);
+  if (base > STA_BACKOFF_MAX) base = STA_BACKOFF_MAX;
+  gSta.wait = base / 2 + esp_random() % (base / 2 + 1);
+  gSta.fails++;
+  gSta.state = STA_BACKOFF;
+  gSta.at = millis();
+  Serial.printf("[wifi] retry in %lu ms\n", (unsigned long)gSta.wait);
+}
+
+// Called once per loop(): never blocks.
+static void staService() {
+  uint32_t now = millis();
+  bool up = WiFi.status() == WL_CONNECTED;
+  switch (gSta.state) {
+    case STA_OFF:
+      return;
+    case STA_JOINING:
+      if (up) {
+        gSta.state = STA_UP;
+        gSta.fails = 0;
+        if (!gSta.upAt) gSta.upAt = now ? now : 1;
+      } else if (gSta.dropped || now - gSta.at > STA_JOIN_TIMEOUT) {
+        WiFi.disconnect();
+        staBackoff();
+      }
+      return;
+    case STA_UP:
+      if (!up) staBackoff();
+      return;
+    case STA_BACKOFF:
+      if (now - gSta.at >= gSta.wait) staJoin();
+      return;
+  }
+}
+
+// "station" once joined, else why the AP is what is serving.
+static String staNote() {
+  switch (gSta.state) {
+    case STA_UP:
+      return "station";
+    case STA_JOINING:
+      return String("fallback AP, joining \"") + gCfg.ssid + "\"";
+    case STA_BACKOFF: {
+      uint32_t gone = millis() - gSta.at;
+      uint32_t left = gone < gSta.wait ? gSta.wait - gone : 0;
+      return String("fallback AP, retry ") + (gSta.fails + 1) + " in " +
+             (left + 999) / 1000 + " s";
+    }
+    default:
+      return "fallback AP";
+  }
+}
+#endif  // AURA_HOST
+
+// ----------------------------------------------------- wasm modules -------
+#ifndef AURA_HOST
+// Installed modules live in WASM_DIR as <name>.wasm and run by name
+// (`run sieve 1000`). The names last run are kept in WASM_HOT_PATH, most
+// recent first, and loaded into the runtime cache after boot.
+
+// WASM_DIR/<name>.wasm for a name of letters, digits, - and _; else empty.
+static String wasmPath(const String &name) {
+  if (!name.length() || name.length() > 24) return String();
+  for (size_t i = 0; i < name.length(); i++)
+    if (!isalnum((unsigned char)name[i]) && name[i] != '-' && name[i] != '_')
+      return String();
+  return String(WASM_DIR) + "/" + name + ".wasm";
+}
+
+// A module file read into one block of exactly its size, PSRAM when
+// present; nullptr with err set.
+static uint8_t *wasmReadFile(const String &path, size_t &n, String &err) {
+  File f = LittleFS.open(path, "r");
+  if (!f) {
+    err = "no such module";
+    return nullptr;
+  }
+  n = f.size();
+  uint8_t *mod = n ? imgAlloc(n) : nullptr;
+  bool ok = mod && f.read(mod, n) == n;
+  f.close();
+  if (!ok) {
+    err = mod || !n ? String("cannot read the module back")
+                    : String("module too big for free RAM (") + (int)n +
+                          " bytes)";
+    free(mod);
+    return nullptr;
+  }
+  return mod;
+}
+
+static std::vector<String> wasmHot() {
+  std::vector<String> names;
+  File f = LittleFS.open(WASM_HOT_PATH, "r");
+  if (!f) return names;
+  String all = f.readString();
+  f.close();
+  int at = 0;
+  while (at < (int)all.length() && (int)names.size() < WASM_HOT) {
+    int nl = all.indexOf('\n', at);
+    if (nl < 0) nl = all.length();
+    String name = all.substring(at, nl);
+    if (wasmPath(name).length()) names.push_back(name);
+    at = nl + 1;
+  }
+  return names;
+}
+
+// Move name to the front of the hot list; only writes when it changes.
+static void wasmTouch(const String &name) {
+  std::vector<String> names = wasmHot();
+  if (names.size() && names[0] == name) return;
+  names.erase(std::remove(names.begin(), names.end(), name), names.end());
+  names.insert(names.begin(), name);
+  if ((int)names.size() > WASM_HOT) names.resize(WASM_HOT);
+  File f = LittleFS.open(WASM_HOT_PATH, "w");
+  if (!f) return;
+  for (auto &n : names) f.print(n + "\n");
+  f.close();
+}
+
+static void wasmForget(const String &name) {
+  std::vector<String> names = wasmHot();
+  auto end = std::remove(names.begin(), names.end(), name);
+  if (end == names.end()) return;
+  names.erase(end, names.end());
+  File f = LittleFS.open(WASM_HOT_PATH, "w");
+  if (!f) return;
+  for (auto &n : names) f.print(n + "\n");
+  f.close();
+}
+
+// Load the hot modules into the runtime cache, coldest first, so the most
+// recently run one ends up least likely to be evicted.
+static void wasmPreload() {
+  std::vector<String> names = wasmHot();
+  for (int i = (int)names.size() - 1; i >= 0; i--) {
+    size_t n = 0;
+    String err;
+    uint8_t *mod = wasmReadFile(wasmPath(names[i]), n, err);
+    if (!mod) continue;
+    WasmCall call;
+    {
+      std::lock_guard<std::mutex> g(gWasmLock);
+      if (!wasmSlot(mod, n, true, call, err)) continue;
+    }
+    Serial.printf("[wasm] preloaded %s (%u bytes) in %.2f ms\n",
+                  names[i].c_str(), (unsigned)n, call.setupUs / 1000.0);
+  }
+}
+
+// "<module> [func] args" into its parts; func defaults to the module's
+// own name.
+static void splitCall(const String &line, String &name, String &fn,
+                      String &rest) {
+  int sp = line.indexOf(' ');
+  name = sp < 0 ? line : line.substring(0, sp);
+  rest = sp < 0 ? String() : line.substring(sp + 1);
+  rest.trim();
+  fn = name;
+  if (rest.length() && !isdigit((unsigned char)rest[0]) && rest[0] != '-' &&
+      rest[0] != '.' && rest[0] != '"') {
+    sp = rest.indexOf(' ');
+    fn = sp < 0 ? rest : rest.substring(0, sp);
+    rest = sp < 0 ? String() : rest.substring(sp + 1);
+    rest.trim();
+  }
+}
+
+// `run <module> [func] args`. A quoted argument, `run b64 base64 "hello"`,
+// is passed as bytes.
+static String cmdRun(const String &line) {
+  String name, fn, rest;
+  splitCall(line, name, fn, rest);
+  String path = wasmPath(name), err;
+  if (!path.length()) return "bad module name — letters, digits, - and _";
+  size_t n = 0;
+  uint8_t *mod = wasmReadFile(path, n, err);
+  if (!mod)
+    return err + " — `wasm` lists the installed modules";
+  wasmTouch(name);
+  if (rest.length() && rest[0] == '"') {  // "text": the byte-buffer ABI
+    int end = rest.length();
+    if (end > 1 && rest[end - 1] == '"') end--;
+    String input = rest.substring(1, end);
+    String label = name + "." + fn + "(\"" +
+                   (input.length() > 24 ? input.substring(0, 24) + "…"
+                                        : input) + "\")";
+    return wasmRunPrompt(mod, n, true, fn, String(), label, &input);
+  }
+  return wasmRunPrompt(mod, n, true, fn, rest,
+                       name + "." + fn + "(" + rest + ")");
+}
+
+// "  sieve     412 B\n" per installed module.
+static String wasmList() {
+  String out;
+  File dir = LittleFS.open(WASM_DIR);
+  if (!dir || !dir.isDirectory()) return out;
+  std::vector<String> lines;
+  for (File f = dir.openNextFile(); f; f = dir.openNextFile()) {
+    String name = f.name();  // a bare name or a full path, by core version
+    name = name.substring(name.lastIndexOf('/') + 1);
+    if (f.isDirectory() || !name.endsWith(".wasm")) continue;
+    char line[64];
+    snprintf(line, sizeof(line), "  %-24s %7u B\n",
+             name.substring(0, name.length() - 5).c_str(),
+             (unsigned)f.size());
+    lines.push_back(line);
+  }
+  std::sort(lines.begin(), lines.end(), [](const String &a, const String &b) {
+    return strcmp(a.c_str(), b.c_str()) < 0;
+  });
+  for (auto &l : lines) out += l;
+  return out;
+}
+
+// `wasm`: installed modules, then the runtime cache.
+static String cmdWasm() {
+  String list = wasmList();
+  return String("installed in ") + WASM_DIR + "/ — `run <module> [func] "
+         "args|\"text\"`\n" +
+         (list.length() ? list : String("  (none)\n")) + "\n" + cmdWasmCache();
+}
+#else
+static String cmdRun(const String &) {
+  return "wasm runs on the chip (no wasm3 here)";
+}
+static String cmdWasm() { return "wasm runs on the chip (no wasm3 here)"; }
+#endif  // AURA_HOST
+
+// --------------------------------------------------- wasm schedules -------
+#ifndef AURA_HOST
+// Installed module functions run at a fixed interval (`every 1s filt
+// filter 3`) on a scheduler task of their own, apart from loop() and the
+// job worker. Due times sit in a min-heap; the task sleeps until the
+// earliest, or until a schedule is added. A run that ends past its next
+// due time is an overrun: the missed ticks are skipped, not run late in a
+// burst. Each run's call time goes to the schedule's CPU account and its
+// result into a ring of the last SCHED_RING. Schedules are kept in
+// WASM_SCHED_PATH and come back after the boot self-tests.
+//
+// The task runs modules in an environment of its own, so it never waits
+// on gWasmLock and prompts, jobs and HTTP calls never see its globals or
+// linear memory. A module is held once however many schedules use it, in
+// a runtime the schedules share; a trap drops that runtime only, and the
+// next run loads it afresh. Runs take turns on the one task, so each is
+// cut off at the shortest live interval: one slow job can cost the others
+// a tick, never a burst of them. Only the task loads or frees the
+// runtimes; other tasks flag a module and wake it.
+static const int SCHED_MAX = 8;
+static const int SCHED_RING = 16;
+static const uint32_t SCHED_MIN_MS = 100;
+
+struct SchedResult {
+  uint32_t at = 0, us = 0;  // millis() when it ended, call time
+  String value;
+};
+
+// An installed module as the schedules run it.
+struct SchedMod {
+  String name;  // "" = free
+  uint8_t *bytes = nullptr;
+  size_t len = 0;
+  IM3Runtime rt = nullptr;  // loaded on its first run
+  int users = 0;  // schedules running it; at 0 the task frees it
+  bool reload = false;  // reinstalled: the task reads it again
+};
+
+struct Sched {
+  int id = 0;  // 0 = free
+  String module, func, args;
+  uint32_t periodMs = 0;
+  int mod = -1;  // its gSchedMods entry
+  bool running = false, cancel = false;  // see schedDrop
+  uint32_t since = 0, runs = 0, overruns = 0, skipped = 0, errors = 0;
+  int64_t cpuUs = 0, maxUs = 0;
+  SchedResult ring[SCHED_RING];
+  int head = 0, count = 0;  // next ring slot, results kept
+};
+
+struct SchedTick {
+  int64_t due;  // esp_timer µs
+  int id;
+  bool operator>(const SchedTick &o) const { return due > o.due; }
+};
+
+static Sched gSched[SCHED_MAX];
+static SchedMod gSchedMods[SCHED_MAX];
+static IM3Environment gSchedEnv = nullptr;  // the task's own, never freed
+static int gSchedSeq = 0;
+static std::vector<SchedTick> gSchedQueue;  // min-heap on due
+static std::mutex gSchedLock;  // guards gSched and gSchedQueue
+static QueueHandle_t gSchedWake = nullptr;
+
+static Sched *schedFind(int id) {
+  for (auto &s : gSched)
+    if (s.id && s.id == id && !s.cancel) return &s;
+  return nullptr;
+}
+
+static void schedPush(int64_t due, int id) {
+  gSchedQueue.push_back({due, id});
+  std::push_heap(gSchedQueue.begin(), gSchedQueue.end(),
+                 std::greater<SchedTick>());
+}
+
+static SchedTick schedPop() {
+  std::pop_heap(gSchedQueue.begin(), gSchedQueue.end(),
+                std::greater<SchedTick>());
+  SchedTick t = gSchedQueue.back();
+  gSchedQueue.pop_back();
+  return t;
+}
+
+// Free a schedule; one that is running is freed by the task afterwards.
+static void schedDrop(Sched &s) {
+  if (s.running) {
+    s.cancel = true;
+    return;
+  }
+  gSchedMods[s.mod].users--;
+  s = Sched();
+}
+
+// "every_ms module func args" per line. Called with gSchedLock held.
+static void schedSave() {
+  File f = LittleFS.open(WASM_SCHED_PATH, "w");
+  if (!f) return;
+  for (auto &s : gSched)
+    if (s.id && !s.cancel)
+      f.printf("%u %s %s %s\n", (unsigned)s.periodMs, s.module.c_str(),
+               s.func.c_str(), s.args.c_str());
+  f.close();
+}
+
+static void schedWake() {
+  int wake = 0;
+  if (gSchedWake) xQueueSend(gSchedWake, &wake, 0);
+}
+
+// Free modules no schedule uses and re-read reinstalled ones; a module
+// that cannot be read stops its schedules. The task only, between runs,
+// with gSchedLock held.
+static void schedTidy() {
+  for (auto &m : gSchedMods) {
+    if (!m.name.length() || (m.users && !m.reload)) continue;
+    if (m.rt) m3_FreeRuntime(m.rt);
+    m.rt = nullptr;
+    free(m.bytes);
+    m.bytes = nullptr;
+    m.reload = false;
+    String err;
+    if (m.users) m.bytes = wasmReadFile(wasmPath(m.name), m.len, err);
+    if (m.bytes) continue;
+    if (m.users) {
+      Serial.printf("[sched] %s: %s — its schedules stopped\n",
+                    m.name.c_str(), err.c_str());
+      for (auto &s : gSched)
+        if (s.id && &gSchedMods[s.mod] == &m) schedDrop(s);
+      schedSave();
+    }
+    m = SchedMod();
+  }
+}
+
+// The cut-off for a run: its interval, but no longer than the shortest
+// live one nor WASM_LIMIT_MS. With gSchedLock held.
+static uint32_t schedLimitMs() {
+  uint32_t ms = WASM_LIMIT_MS;
+  for (auto &s : gSched)
+    if (s.id && !s.cancel && s.periodMs < ms) ms = s.periodMs;
+  return ms;
+}
+
+static void schedTask(void *) {
+  for (;;) {
+    int at = -1;
+    int64_t due = 0;
+    uint32_t waitMs = portMAX_DELAY;
+    SchedMod *mod = nullptr;
+    WasmCall call;
+    String func, args;
+    {
+      std::lock_guard<std::mutex> g(gSchedLock);
+      schedTidy();
+      while (!gSchedQueue.empty()) {
+        Sched *s = schedFind(gSchedQueue.front().id);
+        if (!s) {  // removed since it was queued
+          schedPop();
+          continue;
+        }
+        int64_t now = esp_timer_get_time();
+        if (gSchedQueue.front().due > now) {
+          waitMs = (gSchedQueue.front().due - now + 999) / 1000;
+          break;
+        }
+        due = schedPop().due;
+        at = s - gSched;
+        s->running = true;
+        mod = &gSchedMods[s->mod];
+        call.limitMs = schedLimitMs();
+        func = s->func;
+        args = s->args;
+        break;
+      }
+    }
+    if (at < 0) {
+      int wake;
+      xQueueReceive(gSchedWake, &wake,
+                    waitMs == portMAX_DELAY ? portMAX_DELAY
+                                            : pdMS_TO_TICKS(waitMs));
+      continue;
+    }
+
+    // mod's bytes and runtime change only here, so they need no lock
+    String r;
+    if (!gSchedEnv) gSchedEnv = m3_NewEnvironment();
+    if (!mod->rt && gSchedEnv)
+      mod->rt = wasmLoad(gSchedEnv, mod->bytes, mod->len, r);
+    if (mod->rt) {
+      String toks[8];
+      const char *argv[8];
+      uint32_t argc = splitArgs(args, toks, argv, 8);
+      bool trapped = false;
+      r = wasmInvoke(mod->rt, func.c_str(), argc, argv, call, trapped);
+      if (trapped) {  // its instance is suspect: the next run reloads it
+        m3_FreeRuntime(mod->rt);
+        mod->rt = nullptr;
+      }
+    } else if (!gSchedEnv) {
+      r = "error: no memory for wasm environment";
+    }
+    int64_t end = esp_timer_get_time();
+
+    std::lock_guard<std::mutex> g(gSchedLock);
+    Sched &s = gSched[at];
+    s.running = false;
+    if (s.cancel) {
+      schedDrop(s);
+      continue;
+    }
+    s.runs++;
+    s.cpuUs += call.us;
+    if (call.us > s.maxUs) s.maxUs = call.us;
+    if (!call.ok) s.errors++;
+    SchedResult &res = s.ring[s.head];
+    res.at = millis();
+    res.us = call.us;
+    res.value = r;
+    s.head = (s.head + 1) % SCHED_RING;
+    if (s.count < SCHED_RING) s.count++;
+    int64_t period = s.periodMs * 1000LL;
+    int64_t late = (end - due) / period;  // whole periods past its due time
+    if (late > 0) {
+      s.overruns++;
+      s.skipped += late;
+      if (s.overruns == 1 || s.overruns % 100 == 0)
+        Serial.printf("[sched] %d: %s.%s overran %u time(s), %u ticks "
+                      "skipped\n",
+                      s.id, s.module.c_str(), s.func.c_str(),
+                      (unsigned)s.overruns, (unsigned)s.skipped);
+    }
+    schedPush(due + (late + 1) * period, s.id);
+  }
+}
+
+// "500 ms", "2 s", "5 min"
+static String schedEvery(uint32_t ms) {
+  if (ms % 60000 == 0) return String(ms / 60000) + " min";
+  if (ms % 1000 == 0) return String(ms / 1000) + " s";
+  return String(ms) + " ms";
+}
+
+// Schedule module.func(args) every periodMs; the outcome, as text.
+static String schedAdd(const String &module, const String &func,
+                       const String &args, uint32_t periodMs,
+                       bool save = true) {
+  String path = wasmPath(module), err;
+  if (!path.length()) return "bad module name — letters, digits, - and _";
+  if (periodMs < SCHED_MIN_MS)
+    return String("interval too short — at least ") + SCHED_MIN_MS + " ms";
+
+  std::lock_guard<std::mutex> g(gSchedLock);
+  Sched *s = nullptr;
+  for (auto &c : gSched)
+    if (!c.id) {
+      s = &c;
+      break;
+    }
+  if (!s)
+    return String("all ") + SCHED_MAX + " schedules are in use — " +
+           "`sched <id> stop` frees one";
+  // the module's entry if another schedule runs it, else a free one
+  SchedMod *mod = nullptr;
+  for (auto &m : gSchedMods)
+    if (m.name == module && !m.reload) {
+      mod = &m;
+      break;
+    } else if (!mod && !m.name.length()) {
+      mod = &m;
+    }
+  if (!mod)  // every entry still waits for the task to free it
+    return "the scheduler is still freeing stopped modules — try again";
+  if (!mod->name.length()) {
+    size_t n = 0;
+    uint8_t *bytes = wasmReadFile(path, n, err);
+    if (!bytes) return err + " — `wasm` lists the installed modules";
+    mod->name = module;
+    mod->bytes = bytes;
+    mod->len = n;
+  }
+  if (!gSchedWake) {
+    gSchedWake = xQueueCreate(1, sizeof(int));
+    if (!gSchedWake || xTaskCreatePinnedToCore(schedTask, "aura-sched",
+                                               24 * 1024, nullptr, 1,
+                                               nullptr, 0) != pdPASS) {
+      Serial.println("[sched] cannot start the scheduler task");
+      gSchedWake = nullptr;  // as with the job queue, leaked
+      return "cannot start the scheduler task";
+    }
+  }
+  *s = Sched();
+  s->id = ++gSchedSeq;
+  s->module = module;
+  s->func = func;
+  s->args = args;
+  s->periodMs = periodMs;
+  s->mod = mod - gSchedMods;
+  mod->users++;
+  s->since = millis();
+  schedPush(esp_timer_get_time() + periodMs * 1000LL, s->id);
+  if (save) schedSave();
+  schedWake();  // re-plan the sleep
+  Serial.printf("[sched] %d: %s.%s(%s) every %s\n", s->id, module.c_str(),
+                func.c_str(), args.c_str(), schedEvery(periodMs).c_str());
+  return String("schedule ") + s->id + ": " + module + "." + func + "(" +
+         args + ") every " + schedEvery(periodMs) + " — `sched " + s->id +
+         "` for its results";
+}
+
+static String schedStop(int id) {
+  std::lock_guard<std::mutex> g(gSchedLock);
+  Sched *s = schedFind(id);
+  if (!s) return String("no schedule ") + id;
+  String what = s->module + "." + s->func + "(" + s->args + ")";
+  schedDrop(*s);
+  schedSave();
+  schedWake();  // free its module if nothing else runs it
+  return String("stopped schedule ") + id + ": " + what;
+}
+
+// A module was reinstalled (or deleted): its schedules take the new bytes
+// (or stop).
+static void schedModule(const String &module, bool deleted) {
+  std::lock_guard<std::mutex> g(gSchedLock);
+  bool changed = false;
+  for (auto &m : gSchedMods)
+    if (m.name == module) m.reload = true;
+  for (auto &s : gSched)
+    if (deleted && s.id && !s.cancel && s.module == module) {
+      schedDrop(s);
+      changed = true;
+    }
+  if (changed) schedSave();
+  schedWake();
+}
+
+static void schedLoad() {
+  File f = LittleFS.open(WASM_SCHED_PATH, "r");
+  if (!f) return;
+  String all = f.readString();
+  f.close();
+  int at = 0;
+  while (at < (int)all.length()) {
+    int nl = all.indexOf('\n', at);
+    if (nl < 0) nl = all.length();
+    String line = all.substring(at, nl);
+    at = nl + 1;
+    int sp = line.indexOf(' ');
+    if (sp < 0) continue;
+    String name, fn, rest;
+    splitCall(line.substring(sp + 1), name, fn, rest);
+    String r = schedAdd(name, fn, rest, line.substring(0, sp).toInt(), false);
+    if (!r.startsWith("schedule "))
+      Serial.printf("[sched] not restored: %s\n", r.c_str());
+  }
+}
+
+// "#2 filt.filter(3) every 1 s — 120 runs, ..." then its last result.
+static String schedLine(const Sched &s) {
+  char b[160];
+  uint32_t alive = millis() - s.since;
+  snprintf(b, sizeof(b),
+           " — %u runs, %u overruns (%u ticks skipped), %u errors, cpu "
+           "%.2f ms avg / %.2f ms max, %.2f%% load",
+           (unsigned)s.runs, (unsigned)s.overruns, (unsigned)s.skipped,
+           (unsigned)s.errors, s.runs ? s.cpuUs / 1000.0 / s.runs : 0.0,
+           s.maxUs / 1000.0, alive ? s.cpuUs / 10.0 / alive : 0.0);
+  String out = String("#") + s.id + " " + s.module + "." + s.func + "(" +
+               s.args + ") every " + schedEvery(s.periodMs) + b;
+  if (s.count) {
+    const SchedResult &r = s.ring[(s.head + SCHED_RING - 1) % SCHED_RING];
+    out += String("\n    last: ") + r.value + " (" +
+           (millis() - r.at) / 1000 + " s ago)";
+  }
+  return out;
+}
+
+// `sched`: every schedule; `sched <id>`: its results, newest first.
+static String schedText(int id) {
+  std::lock_guard<std::mutex> g(gSchedLock);
+  if (!id) {
+    String out;
+    int n = 0;
+    for (auto &s : gSched)
+      if (s.id && !s.cancel) {
+        out += "  " + schedLine(s) + "\n";
+        n++;
+      }
+    return String("schedules — ") + n + " of " + SCHED_MAX +
+           ", `every <interval> <module> [func] args` adds one\n" +
+           (n ? out : String("  (none)\n"));
+  }
+  Sched *s = schedFind(id);
+  if (!s) return String("no schedule ") + id;
+  String out = schedLine(*s) + "\n";
+  char b[48];
+  for (int i = 1; i <= s->count; i++) {
+    const SchedResult &r = s->ring[(s->head + SCHED_RING - i) % SCHED_RING];
+    snprintf(b, sizeof(b), "  %9.1f s  %8.2f ms  ", r.at / 1000.0,
+             r.us / 1000.0);
+    out += b + r.value + "\n";
+  }
+  return out;
+}
+
+// `every 1s filt filter 3`: the interval takes ms, s (the default), min
+// or h.
+static String cmdEvery(const String &line) {
+  int sp = line.indexOf(' ');
+  if (sp < 0)
+    return "every <interval> <module> [func] args — e.g. every 5s filt "
+           "filter 3";
+  String iv = line.substring(0, sp);
+  double v = iv.toFloat();
+  String unit = iv.substring(strspn(iv.c_str(), "0123456789."));
+  double scale = 0;
+  if (unit == "ms")
+    scale = 1;
+  else if (unit == "" || unit == "s")
+    scale = 1000;
+  else if (unit == "min" || unit == "m")
+    scale = 60000;
+  else if (unit == "h")
+    scale = 3600000;
+  if (!(v > 0) || !scale) return "interval: a number with ms, s, min or h";
+  String name, fn, rest;
+  splitCall(line.substring(sp + 1), name, fn, rest);
+  return schedAdd(name, fn, rest, (uint32_t)(v * scale));
+}
+
+static String cmdSched(const String &line) {
+  int id = line.toInt();
+  if (id && line.endsWith(" stop")) return schedStop(id);
+  return schedText(id);
+}
+#else
+static String cmdEvery(const String &) {
+  return "wasm runs on the chip (no wasm3 here)";
+}
+static String cmdSched(const String &) {
+  return "wasm runs on the chip (no wasm3 here)";
+}
+#endif  // AURA_HOST
+
+// --------------------------------------------------------- commands ---------
+
+// "automation v3 (23 topics), drives v1 (9 topics)" or "none".
+static String packSummary() {
+  LiveModels live;
+  String out;
+  for (const Model *m : live->packs) {
+    if (out.length()) out += ", ";
+    out += String(m->name) + " v" + m->version + " (" + (int)m->nEntries +
+           " topics)";
+  }
+  return out.length() ? out : String("none");
+}
+
+#ifndef AURA_HOST
+// Boot phases: begin() opens each phase with bootPhase("name") and closes
+// the last with bootPhase(nullptr). Every phase records its duration and
+// free heap / largest free block / free PSRAM on entry and on exit.
+struct BootPhase {
+  const char *name;
+  uint32_t ms;
+  uint32_t heap[2], largest[2], psram[2];  // [0] before, [1] after
+};
+static BootPhase gBoot[12];
+static int gBootN = 0;
+static uint32_t gBootAt = 0;  // millis() when the open phase started
+static uint32_t gBootReady = 0;   // millis() when the web server listened
+static uint32_t gBootServed = 0;  // millis() when the first page went out
+
+static void bootServed() {
+  if (!gBootServed) gBootServed = millis();
+}
+
+static void bootSample(uint32_t *heap, uint32_t *largest, uint32_t *psram) {
+  *heap = ESP.getFreeHeap();
+  *largest = ESP.getMaxAllocHeap();
+  *psram = ESP.getFreePsram();
+}
+
+static void bootPhase(const char *name) {
+  if (gBootN && !gBoot[gBootN - 1].ms) {
+    BootPhase &p = gBoot[gBootN - 1];
+    p.ms = millis() - gBootAt;
+    if (!p.ms) p.ms = 1;  // 0 marks the phase still open
+    bootSample(&p.heap[1], &p.largest[1], &p.psram[1]);
+    Serial.printf("[boot] %s: %lu ms, heap %u KB\n", p.name,
+                  (unsigned long)p.ms, (unsigned)(p.heap[1] / 1024));
+  }
+  if (!name || gBootN == (int)(sizeof(gBoot) / sizeof(gBoot[0]))) return;
+  BootPhase &p = gBoot[gBootN++];
+  p.name = name;
+  p.ms = 0;
+  bootSample(&p.heap[0], &p.largest[0], &p.psram[0]);
+  gBootAt = millis();
+}
+
+// "boot: 1480 ms, slowest load models (610 ms)" for `status`.
+static String bootSummary() {
+  uint32_t total = 0;
+  int slow = -1;
+  for (int i = 0; i < gBootN; i++) {
+    total += gBoot[i].ms;
+    if (slow < 0 || gBoot[i].ms > gBoot[slow].ms) slow = i;
+  }
+  if (slow < 0) return "boot: not recorded";
+  return String("boot: ") + total + " ms, slowest " + gBoot[slow].name +
+         " (" + gBoot[slow].ms + " ms) — details at /api/boot";
+}
+
+// Full per-phase table served at /api/boot; memory in KB, before → after.
+static String bootReport() {
+  String out = bootSummary() + "\n" + "ready " + gBootReady +
+               " ms after power-on, first page served " +
+               (gBootServed ? String(gBootServed) + " ms" : String("—")) +
+               ", station " +
+               (gSta.upAt ? String("up at ") + gSta.upAt + " ms"
+                          : String("not up")) +
+               "\n"
+               "phase                ms  heap KB      largest KB   psram KB\n";
+  char line[112];
+  for (int i = 0; i < gBootN; i++) {
+    const BootPhase &p = gBoot[i];
+    snprintf(line, sizeof(line),
+             "%-16s %6lu  %4u → %-4u  %4u → %-4u  %4u → %u\n", p.name,
+             (unsigned long)p.ms, (unsigned)(p.heap[0] / 1024),
+             (unsigned)(p.heap[1] / 1024), (unsigned)(p.largest[0] / 1024),
+             (unsigned)(p.largest[1] / 1024), (unsigned)(p.psram[0] / 1024),
+             (unsigned)(p.psram[1] / 1024));
+    out += line;
+  }
+  return out;
+}
+
+// Boot self-tests: wasm fib(24), one knowledge retrieval and one primary
+// prompt. The retrieval asks the first pack's first entry in its own
+// keywords, so it holds for whatever domain is loaded. They run in a
+// low-priority task once the server is up, which then preloads the hot
+// wasm modules. Passing results are cached in SELFTEST_PATH keyed on the
+// running app image and the loaded packs, so an unchanged device skips
+// them next boot.
+
+// The running app image's ELF SHA-256, folded to 32 bits: new firmware
+// retests, a rebuild that links the same image doesn't.
+static uint32_t buildId() {
+  static const uint32_t id =
+      fnv1a(FNV_SEED, appDescription()->app_elf_sha256,
+            sizeof(appDescription()->app_elf_sha256));
+  return id;
+}
+
+struct SelfTest {
+  const char *name;
+  bool ok;
+  uint32_t us;
+};
+static SelfTest gSelfTest[3] = {
+    {"wasm", false, 0}, {"knowledge", false, 0}, {"primary", false, 0}};
+static std::atomic<int> gSelfTestState{0};  // 0 pending, 1 ran, 2 cached
+
+static bool selfTestCached(uint32_t models) {
+  File f = LittleFS.open(SELFTEST_PATH, "r");
+  if (!f) return false;
+  String line = f.readString();
+  f.close();
+  unsigned build, pack, us[3];
+  if (sscanf(line.c_str(), "%x %x %u %u %u", &build, &pack, &us[0], &us[1],
+             &us[2]) != 5 ||
+      build != buildId() || pack != models)
+    return false;
+  for (int i = 0; i < 3; i++) gSelfTest[i] = {gSelfTest[i].name, true, us[i]};
+  return true;
+}
+
+static void selfTestRun(ModelSet &live) {
+  const char *argv[1] = {"24"};
+  WasmCall call;
+  String r = runWasmModule(FIB_WASM, sizeof(FIB_WASM), "fib", 1, argv, &call);
+  gSelfTest[0].ok = r == "46368";
+  gSelfTest[0].us = call.us + call.setupUs;
+
+  std::lock_guard<std::mutex> g(gPromptLock);
+  int64_t t0 = esp_timer_get_time();
+  const Model *first = live.packs.size() ? live.packs[0] : nullptr;
+  if (first && first->nEntries) {
+    String probe;
+    for (uint32_t j = first->entKw0[0]; j < first->entKw0[1]; j++)
+      probe += String(first->str + first->kwStr[first->entKw[j]]) + " ";
+    Tokens toks;
+    tokenizePrompt(probe, toks);
+    // rank and read the answer, as a prompt would, without touching the
+    // prompt cache counters
+    Ranking rk = rankModels(live, toks.t, toks.n);
+    Model &m = *live.packs[rk.pack];
+    const char *a = rk.best >= 0 && rk.bestScore >= m.threshold
+                        ? modelAnswer(m, rk.best)
+                        : "";
+    gSelfTest[1].ok = a && a[0];
+  } else {
+    gSelfTest[1].ok = true;  // nothing to check without an entry
+  }
+  gSelfTest[1].us = esp_timer_get_time() - t0;
+
+  t0 = esp_timer_get_time();
+  Tokens hwToks;
+  tokenizePrompt("cek suhu sekarang", hwToks);
+  gSelfTest[2].ok = tryPrimary(live, hwToks).length() > 0;
+  gSelfTest[2].us = esp_timer_get_time() - t0;
+}
+
+static void selfTestTask(void *) {
+  {
+    LiveModels live;
+    if (selfTestCached(live->hash)) {
+      gSelfTestState = 2;
+    } else {
+      selfTestRun(*live);
+      bool pass = gSelfTest[0].ok && gSelfTest[1].ok && gSelfTest[2].ok;
+      if (pass) {
+        File f = LittleFS.open(SELFTEST_PATH, "w");
+        if (f) {
+          f.printf("%08x %08x %u %u %u\n", (unsigned)buildId(),
+                   (unsigned)live->hash, (unsigned)gSelfTest[0].us,
+                   (unsigned)gSelfTest[1].us, (unsigned)gSelfTest[2].us);
+          f.close();
+        }
+      } else {
+        LittleFS.remove(SELFTEST_PATH);
+      }
+      gSelfTestState = 1;
+    }
   }
-  return String("⚙ ") + pinStateStr(pin) +
-         (gPinMode[pin] == 2 ? "  (floating unless something is wired)" : "");
+  Serial.printf("[selftest] wasm %s, knowledge %s, primary %s%s\n",
+                gSelfTest[0].ok ? "OK" : "FAILED",
+                gSelfTest[1].ok ? "OK" : "FAILED",
+                gSelfTest[2].ok ? "OK" : "FAILED",
+                gSelfTestState == 2 ? " (cached)" : "");
+  wasmPreload();
+  schedLoad();
+  vTaskDelete(nullptr);
 }
 
-// --------------------------------------------------------- commands ---------
+// "self-test: wasm OK 2.10 ms, knowledge OK 0.84 ms, primary OK 0.31 ms"
+static String selfTestSummary() {
+  int state = gSelfTestState;
+  if (!state) return "self-test: pending";
+  String out = "self-test:";
+  for (int i = 0; i < 3; i++)
+    out += String(i ? ", " : " ") + gSelfTest[i].name +
+           (gSelfTest[i].ok ? " OK " : " FAILED ") +
+           String(gSelfTest[i].us / 1000.0, 2) + " ms";
+  return out + (state == 2 ? " (cached)" : "");
+}
 
 static String cmdStatus() {
   bool sta = (WiFi.status() == WL_CONNECTED);
-  char buf[704];
+  String packs = packSummary(), link = staNote();
+  String wasm = "busy running a call";
+  {
+    std::unique_lock<std::mutex> g(gWasmLock, std::try_to_lock);
+    if (g.owns_lock()) {
+      int warm = 0;
+      for (auto &w : gWasm.slot) warm += w.used != 0;
+      wasm = String(warm) + " warm runtimes, " +
+             (int)(wasmCached() / 1024) + " KB";
+    }
+  }
+  char buf[960];
   snprintf(buf, sizeof(buf),
            "AURA on %s rev %d @ %lu MHz\n"
            "flash: %u KB | psram: %u KB (free %u KB)\n"
            "heap: %u KB free | fs: %u/%u KB used\n"
            "uptime: %lu s\n"
            "wifi: %s (%s) | ip: %s | rssi: %d dBm\n"
-           "wasm: wasm3 v" M3_VERSION "\n"
-           "primary model: hardware (built-in) | additional: %s v%d (%u topics)",
+           "wasm: wasm3 v" M3_VERSION " | %s\n"
+           "primary model: hardware (built-in) | additional: %s\n"
+           "prompt cache: %u hits / %u misses (%d slots)\n%s\n%s",
            ESP.getChipModel(), ESP.getChipRevision(),
            (unsigned long)ESP.getCpuFreqMHz(),
            (unsigned)(ESP.getFlashChipSize() / 1024),
@@ -764,22 +4754,93 @@ static String cmdStatus() {
            (unsigned)(LittleFS.usedBytes() / 1024),
            (unsigned)(LittleFS.totalBytes() / 1024),
            (unsigned long)(millis() / 1000),
-           sta ? gCfg.ssid : gCfg.apSsid, sta ? "station" : "fallback AP",
+           sta ? gCfg.ssid : gCfg.apSsid, link.c_str(),
            sta ? WiFi.localIP().toString().c_str()
                : WiFi.softAPIP().toString().c_str(),
-           sta ? (int)WiFi.RSSI() : 0,
-           gModel.ok ? gModel.name.c_str() : "none", gModel.version,
-           (unsigned)gModel.entries.size());
+           sta ? (int)WiFi.RSSI() : 0, wasm.c_str(), packs.c_str(),
+           (unsigned)gPromptCache.hits, (unsigned)gPromptCache.misses,
+           PromptCache::SLOTS,
+           bootSummary().c_str(), selfTestSummary().c_str());
   return String(buf);
 }
+#else
+static String cmdStatus() {
+  return String("AURA host build\nadditional: ") + packSummary() +
+         "\nprompt cache: " +
+         gPromptCache.hits + " hits / " + gPromptCache.misses + " misses";
+}
+#endif  // AURA_HOST
+
+// `bench prompt`: the path every chat prompt takes before an answer is
+// formatted — tokenize, primary-model check, index score — over typical
+// knowledge prompts, with heap allocations counted by the heap hooks.
+static String cmdBenchPrompt() {
+  static const char *prompts[] = {
+      "what is a plc",
+      "How does a PID controller work?",
+      "explain modbus vs mqtt",
+      "difference between open loop and closed loop control",
+      "apa itu sensor dan aktuator",
+      "which industrial robots are used in factories",
+      "tell me about the weather in paris",
+  };
+  const int kRounds = 50;
+  LiveModels live;
+  if (live->packs.empty()) return "bench prompt: no knowledge model loaded";
+  String out = String("bench prompt — tokenize + primary check + index "
+                      "score, ") + kRounds + " rounds\n"
+               "  allocs/q     µs/q  tokens  prompt\n";
+  volatile int sink = 0;
+  for (const char *p : prompts) {
+    uint32_t a0 = 0;
+    int64_t us = 0;
+    int nTok = 0;
+    for (int r = 0; r <= kRounds; r++) {
+      if (r == 1) {  // round 0 warms the reusable scratch vectors
+        a0 = gAllocs;
+        us = esp_timer_get_time();
+      }
+      Tokens toks;
+      tokenizePrompt(p, strlen(p), toks);
+      nTok = toks.n;
+      if (!tryPrimary(*live, toks).length())
+        sink = sink + rankModels(*live, toks.t, toks.n).bestScore;
+    }
+    us = esp_timer_get_time() - us;
+    uint32_t allocs = gAllocs - a0;
+    char b[160];
+    if (kAllocHooks)
+      snprintf(b, sizeof(b), "  %8.2f", allocs / (double)kRounds);
+    else
+      snprintf(b, sizeof(b), "       n/a");
+    out += b;
+    snprintf(b, sizeof(b), " %8.1f  %6d  %s\n", us / (double)kRounds, nTok,
+             p);
+    out += b;
+  }
+  if (!kAllocHooks)
+    out += "(allocation counts need CONFIG_HEAP_USE_HOOKS in the IDF config)";
+  return out;
+}
+
+// Case-insensitive command match on the trimmed prompt span, no copies.
+static bool promptIs(const char *p, size_t n, const char *cmd) {
+  return strlen(cmd) == n && strncasecmp(p, cmd, n) == 0;
+}
+static bool promptStarts(const char *p, size_t n, const char *cmd) {
+  size_t l = strlen(cmd);
+  return n >= l && strncasecmp(p, cmd, l) == 0;
+}
 
-static String processPrompt(String p) {
-  p.trim();
-  if (p.length() == 0) return "say something :)";
-  String low = p;
-  low.toLowerCase();
+static String processPrompt(const String &in) {
+  std::lock_guard<std::mutex> g(gPromptLock);
+  const char *p = in.c_str();
+  size_t n = in.length();
+  while (n && isspace((unsigned char)p[n - 1])) n--;
+  while (n && isspace((unsigned char)*p)) p++, n--;
+  if (n == 0) return "say something :)";
 
-  if (low == "help")
+  if (promptIs(p, n, "help"))
     return "I am AURA, on-device intelligence with two models:\n\n"
            "PRIMARY model — greetings + hardware (built-in, irreplaceable):\n"
            "  hw               device hardware overview + pin states\n"
@@ -793,25 +4854,288 @@ static String processPrompt(String p) {
            "ADDITIONAL model — knowledge domain (swappable, TOON format):\n"
            "  model            show the loaded knowledge model\n"
            "  ...any question  answered if in-domain, declined if not\n\n"
-           "Other: status, fib <n> (wasm on-chip), echo <txt>. Swap knowledge "
-           "models in the Model panel below.";
-  if (low == "status") return cmdStatus();
-  if (low == "model" || low == "models") return cmdModelInfo();
-  if (low == "fib") return cmdFib(24);
-  if (low.startsWith("fib ")) return cmdFib(p.substring(4).toInt());
-  if (low.startsWith("echo ")) return p.substring(5);
-
-  String prim = tryPrimary(low);
+           "Other: status, fib <n> (wasm on-chip), run <module> [func] "
+           "args|\"text\", job <id>, every <interval> <module> [func] args, "
+           "sched [<id> [stop]], wasm (modules + runtime cache), echo <txt>, "
+           "bench model, bench parse, bench prompt, bench bytes, bench wasm. "
+           "Swap knowledge models in the Model panel below.";
+  if (promptIs(p, n, "status")) return cmdStatus();
+  if (promptIs(p, n, "model") || promptIs(p, n, "models"))
+    return cmdModelInfo();
+  if (promptIs(p, n, "bench model")) return cmdBenchModel();
+  if (promptIs(p, n, "bench parse")) return cmdBenchParse();
+  if (promptIs(p, n, "bench prompt")) return cmdBenchPrompt();
+  if (promptIs(p, n, "bench bytes")) return cmdBenchBytes();
+  if (promptIs(p, n, "bench wasm")) return cmdBenchWasm();
+  if (promptIs(p, n, "wasm")) return cmdWasm();
+  if (promptStarts(p, n, "run ")) {
+    size_t at = p - in.c_str();
+    return cmdRun(in.substring(at + 4, at + n));
+  }
+  if (promptStarts(p, n, "job ")) return cmdJob(atol(p + 4));
+  if (promptStarts(p, n, "every ") && n > 6 && isdigit((unsigned char)p[6])) {
+    size_t at = p - in.c_str();
+    return cmdEvery(in.substring(at + 6, at + n));
+  }
+  if (promptIs(p, n, "sched")) return cmdSched(String());
+  if (promptStarts(p, n, "sched ")) {
+    size_t at = p - in.c_str();
+    return cmdSched(in.substring(at + 6, at + n));
+  }
+  if (promptIs(p, n, "fib")) return cmdFib(24);
+  if (promptStarts(p, n, "fib ")) return cmdFib(atol(p + 4));
+  if (promptStarts(p, n, "echo ")) {
+    size_t at = p - in.c_str();
+    return in.substring(at + 5, at + n);
+  }
+
+  Tokens toks;
+  tokenizePrompt(p, n, toks);
+  LiveModels live;  // an install may swap packs mid-query; keep this set
+  // a cached prompt is one the primary model already passed on
+  Ranking cached;
+  if (promptCacheGet(*live, toks, cached)) return modelReply(*live, cached);
+  String prim = tryPrimary(*live, toks);
   if (prim.length()) {
-    Serial.printf("[primary] %s\n", p.c_str());
+    Serial.printf("[primary] %.*s\n", (int)n, p);
     return prim;
   }
 
-  return askModel(p);
+  return askModel(*live, toks);
 }
 
 String AuraClass::ask(const String &prompt) { return processPrompt(prompt); }
 
+// ------------------------------------------------------ model patches -------
+// A patch edits a stored pack without resending it. TOON, like a pack:
+//   base: 1a2b3c4d             FNV-1a of the pack text it applies to
+//   version: 4                 any header field, replaced
+//   delete[2]: "Old topic",#7  entries by title or 0-based row number
+//   entries[1]{t,k,a}:         rows replacing the entry with the same
+//     "Modbus","modbus:2","…"  title, or added at the end
+struct ModelPatch {
+  uint32_t base = 0;
+  bool hasBase = false;
+  std::vector<std::pair<String, String>> fields;  // header, value as written
+  std::vector<String> delTitles;
+  std::vector<long> delIds;
+  std::vector<ModelEntry> rows;
+};
+
+static bool parsePatch(PackFile &src, ModelPatch &p, String &err,
+                       int &line) {
+  ToonParser *tp = new ToonParser();
+  ToonPack hdr;
+  tp->begin(hdr, [tp, &p](ModelEntry &e) {
+    String why;
+    if (!entryFits(e, p.rows.size(), why)) return tp->fail(why, tp->lineNo);
+    p.rows.push_back(e);
+    return true;
+  });
+  tp->partial = true;
+  tp->onField = [tp, &p](const String &key, const String &val) {
+    if (key == "base") {
+      char *end;
+      p.base = strtoul(val.c_str(), &end, 16);
+      p.hasBase = *end == 0 && val.length();
+      if (!p.hasBase) tp->fail("base must be a hex content hash", tp->lineNo);
+    } else if (key.startsWith("delete")) {
+      char refs[MAX_TOON_LINE];
+      size_t n = snprintf(refs, sizeof(refs), "%s", val.c_str()), i = 0;
+      while (i < n) {
+        char *r = ToonParser::field(refs, n, i);
+        if (r[0] == '#' && isdigit((unsigned char)r[1]))
+          p.delIds.push_back(atol(r + 1));
+        else if (*r)
+          p.delTitles.push_back(r);
+      }
+    } else if (key == "name" || key == "version" || key == "author" ||
+               key == "description" || key == "threshold" ||
+               key == "temperature") {
+      p.fields.push_back({key, val});
+    } else {
+      tp->fail(String("unknown patch field: ") + key, tp->lineNo);
+    }
+  };
+  bool ok = feedToon(*tp, src);
+  err = tp->err;
+  line = tp->errLine;
+  delete tp;
+  return ok;
+}
+
+// One always-quoted field of a TOON row ("" escapes a quote).
+static void putToonField(String &out, const String &v) {
+  out += '"';
+  for (size_t i = 0; i < v.length(); i++) {
+    if (v[i] == '"') out += '"';
+    out += v[i];
+  }
+  out += '"';
+}
+
+static String toonRow(const ModelEntry &e) {
+  String row = "  ", kw;
+  putToonField(row, e.t);
+  row += ',';
+  for (auto &kv : e.k) {
+    if (kw.length()) kw += ' ';
+    kw += kv.first + ":" + kv.second;
+  }
+  putToonField(row, kw);
+  row += ',';
+  putToonField(row, e.a);
+  row += '\n';
+  return row;
+}
+
+struct PatchStats {
+  int replaced = 0, added = 0, deleted = 0, count = 0;
+};
+
+// Write outPath: the pack m was compiled from, with p applied. Titles and
+// row numbers resolve against m; the file is then streamed once, kept rows
+// copied byte for byte, and stored as TZ1.
+static bool applyPatch(const Model &m, const ModelPatch &p,
+                       const char *outPath, PatchStats &st, String &err) {
+  const int32_t KEEP = -1, DROP = -2;
+  uint32_t n = m.nEntries;
+  std::vector<int32_t> fate(n, KEEP);  // or the patch row replacing it
+  for (long id : p.delIds) {
+    if (id < 0 || id >= (long)n || fate[id] == DROP) {
+      err = String("delete: no entry #") + id;
+      return false;
+    }
+    fate[id] = DROP;
+  }
+  for (const String &t : p.delTitles) {
+    uint32_t i = 0;
+    while (i < n && (fate[i] == DROP || t != modelTitle(m, i))) i++;
+    if (i == n) {
+      err = String("delete: no entry \"") + t + "\"";
+      return false;
+    }
+    fate[i] = DROP;
+  }
+  std::vector<int> added;
+  for (size_t j = 0; j < p.rows.size(); j++) {
+    uint32_t i = 0;
+    while (i < n && (fate[i] != KEEP || p.rows[j].t != modelTitle(m, i))) i++;
+    if (i < n)
+      fate[i] = j;
+    else
+      added.push_back(j);
+  }
+  st.deleted = p.delIds.size() + p.delTitles.size();
+  st.added = added.size();
+  st.replaced = p.rows.size() - added.size();
+  st.count = n - st.deleted + st.added;
+  if (st.count <= 0) {
+    err = "the patch leaves no entries";
+    return false;
+  }
+
+  // header: the base's fields, then the patch's as written
+  const char *keys[] = {"name", "version", "author", "description",
+                        "threshold", "temperature"};
+  char temp[16];
+  snprintf(temp, sizeof(temp), "%g", m.temperature);
+  String vals[] = {m.name, String(m.version), m.author, m.desc,
+                   String(m.threshold), temp};
+  for (String &v : vals)  // the parser strips one pair of outer quotes
+    if (v.startsWith("\"")) v = String("\"") + v + "\"";
+  for (auto &f : p.fields)
+    for (int k = 0; k < 6; k++)
+      if (f.first == keys[k]) vals[k] = f.second;
+  String head;
+  for (int k = 0; k < 6; k++)
+    if (vals[k].length()) head += String(keys[k]) + ": " + vals[k] + "\n";
+  head += String("entries[") + st.count + "]{t,k,a}:\n";
+
+  PackFile in, raw;
+  File out = LittleFS.open(outPath, "w");
+  if (!openModelSource(m, in) || !openModelSource(m, raw) || !out) {
+    err = "cannot open the pack files";
+    return false;
+  }
+  PackWriter w(out);
+  bool ok = w.write(head);
+  ToonParser *tp = new ToonParser();
+  ToonPack hdr;
+  uint32_t i = 0;
+  tp->begin(hdr, [&](ModelEntry &) {
+    if (i == n) return ok = false;  // the file is not the compiled pack
+    int32_t f = fate[i++];
+    if (f >= 0) {
+      ok = ok && w.write(toonRow(p.rows[f]));
+    } else if (f == KEEP) {  // the row as stored, its newline included
+      uint8_t buf[256];
+      uint32_t left = tp->fed - tp->lineAt;
+      bool nl = false;
+      ok = ok && raw.seek(tp->lineAt);
+      while (ok && left) {
+        size_t got = raw.read(buf, std::min<size_t>(left, sizeof(buf)));
+        ok = got && w.write(buf, got);
+        left -= got;
+        nl = got && buf[got - 1] == '\n';
+      }
+      if (ok && !nl) ok = w.write((const uint8_t *)"\n", 1);
+    }
+    return ok;
+  });
+  ok = feedToon(*tp, in) && ok && i == n;
+  delete tp;
+  for (int j : added) ok = ok && w.write(toonRow(p.rows[j]));
+  ok = ok && w.finish();
+  in.close();
+  raw.close();
+  out.close();
+  if (!ok) {
+    err = "cannot write the patched pack";
+    LittleFS.remove(outPath);
+  }
+  return ok;
+}
+
+// Apply the patch in src to the live pack at path, writing the result to
+// outPath: the pack must have been compiled from the patch's base. An
+// HTTP status; msg says why when it is not 200.
+static int patchPack(PackFile &src, const String &path, const char *outPath,
+                     PatchStats &st, String &msg) {
+  ModelPatch p;
+  String err;
+  int line = 0;
+  if (!parsePatch(src, p, err, line)) {
+    msg = String("rejected: ") + err + " (line " + line + ")";
+    return 422;
+  }
+  if (!p.hasBase) {
+    msg = "rejected: the patch names no base hash";
+    return 422;
+  }
+  LiveModels live;
+  const Model *m = nullptr;
+  for (const Model *c : live->packs)
+    if (c->src == path) m = c;
+  char hex[9];
+  if (!m) {
+    msg = String("no pack at ") + path;
+    return 404;
+  }
+  if (m->img->srcHash != p.base) {
+    snprintf(hex, sizeof(hex), "%08x", (unsigned)m->img->srcHash);
+    msg = String("base mismatch: the pack is ") + hex +
+          " — install it whole instead";
+    return 409;
+  }
+  if (!applyPatch(*m, p, outPath, st, err)) {
+    msg = String("rejected: ") + err;
+    return 422;
+  }
+  return 200;
+}
+
+#ifndef AURA_HOST
 // ------------------------------------------------------------- http ---------
 
 static void handlePrompt() {
@@ -820,169 +5144,683 @@ static void handlePrompt() {
   server.send(200, "text/plain; charset=utf-8", processPrompt(body));
 }
 
-static void handleUploadChunk() {
+// Where an install or download goes: MODEL_PATH, or MODELS_DIR/<pack>.toon
+// for ?pack=<name> (letters, digits, - and _). Empty for a bad name.
+static String packArg() {
+  String name = server.arg("pack");
+  if (!name.length()) return MODEL_PATH;
+  if (name.length() > 24) return String();
+  for (size_t i = 0; i < name.length(); i++)
+    if (!isalnum((unsigned char)name[i]) && name[i] != '-' && name[i] != '_')
+      return String();
+  return String(MODELS_DIR) + "/" + name + ".toon";
+}
+
+// Compile the pack file tmp and swap it in as the pack at path without a
+// reboot: a second model is built in heap and published (queries already
+// running finish on the old one), the file is renamed over the old one,
+// so a power cut leaves either pack in place, never neither; then for
+// MODEL_PATH the flash image is compiled and published too — the
+// partition is only rewritten once nothing maps it. Nothing waits for
+// those queries: an old pack one still holds that reads its answers from
+// the file gets a copy in MODEL_RETIRED_DIR, removed when the pack is
+// freed. On failure the temporary file is dropped and the old pack stays.
+// Under gInstallLock.
+static uint32_t gRetiredSeq = 0;
+
+// Copy from into to; on failure to is removed.
+static bool copyFile(const char *from, const char *to) {
+  File in = LittleFS.open(from, "r"), out = LittleFS.open(to, "w");
+  bool ok = in && out;
+  uint8_t buf[512];
+  while (ok) {
+    size_t n = in.read(buf, sizeof(buf));
+    if (!n) break;
+    ok = out.write(buf, n) == n;
+  }
+  if (in) in.close();
+  if (out) out.close();
+  if (!ok) LittleFS.remove(to);
+  return ok;
+}
+
+static bool activateNext(const char *tmp, const String &path) {
+  Model *next = new Model();
+  if (!compileModel(tmp, nullptr, *next)) {
+    modelRelease(next);
+    LittleFS.remove(tmp);
+    return false;
+  }
+  Model *old = modelsSwap(path, next);
+  bool held = false;
+  if (old) {
+    std::lock_guard<std::mutex> g(gModelLock);
+    held = old->lazy && old->refs > 1;
+  }
+  String aside;
+  if (held) {  // path is only replaced below, so the copy is the old pack
+    LittleFS.mkdir(MODEL_RETIRED_DIR);
+    aside = String(MODEL_RETIRED_DIR) + "/" + ++gRetiredSeq;
+    if (!copyFile(path.c_str(), aside.c_str())) aside = "";
+  }
+  bool moved;
+  {
+    std::lock_guard<std::mutex> g(gModelLock);
+    if (path != MODEL_PATH) LittleFS.mkdir(MODELS_DIR);
+    moved = LittleFS.rename(tmp, path.c_str());  // replaces the old file
+    if (moved) {
+      next->src = path;
+      if (aside.length()) {
+        old->src = aside;
+        old->retired = true;
+      }
+    }
+  }
+  if (!moved) {  // path still holds the old pack: put it back
+    Serial.printf("[model] ERROR: cannot move %s to %s\n", tmp,
+                  path.c_str());
+    if (aside.length()) LittleFS.remove(aside.c_str());
+    modelRelease(modelsSwap(tmp, nullptr));  // next, still reading tmp
+    if (old) modelRelease(modelsSwap(path, old));
+    LittleFS.remove(tmp);
+    return false;
+  }
+  if (old) modelRelease(old);
+  const esp_partition_t *part = modelPartition();
+  if (part && path == MODEL_PATH && gPartitionMaps == 0) {
+    Model *img = new Model();
+    if (compileModel(MODEL_PATH, part, *img) && img->mapped) {
+      if (Model *heap = modelsSwap(MODEL_PATH, img)) modelRelease(heap);
+    } else {
+      modelRelease(img);  // stays in heap; the next boot retries
+    }
+  }
+  return true;
+}
+
+// Swap the validated pack file tmp in as path; the reply goes to msg.
+static int finishInstall(const char *tmp, const String &path,
+                         const ToonPack &m, int count, size_t text,
+                         size_t stored, uint32_t t0, String &msg) {
+  if (!activateNext(tmp, path)) {
+    msg = "cannot compile or store the model — the old one stays active";
+    return 500;
+  }
+  Serial.printf("[model] installed \"%s\" v%d (%u entries, %u bytes, %u "
+                "stored) as %s in %u ms — no reboot\n",
+                m.name.c_str(), m.version, (unsigned)count, (unsigned)text,
+                (unsigned)stored, path.c_str(), (unsigned)(millis() - t0));
+  msg = String("knowledge model \"") + m.name + "\" v" + m.version +
+        " installed (" + count + " entries, " + (int)stored +
+        " bytes in flash) and now active — no reboot. The primary "
+        "hardware model is unaffected.";
+  return 200;
+}
+
+// Where an uploaded or fetched pack goes as it arrives: into a file, one
+// chunk at a time. TOON text is fed through the parser and compressed on
+// the way, so a bad pack is refused at its first bad line; TZ1 bytes and
+// patches are written as they came and checked from the file afterwards.
+struct PackSink : public Stream {
+  File &f;
+  bool patch, raw = false, decided = false, full = false;
+  uint8_t head[4];
+  size_t seen = 0;  // bytes held back until TZ1 can be told from text
+  uint32_t got = 0;
+  std::atomic<uint32_t> *progress = nullptr;
+  ToonParser *tp = nullptr;
+  ToonPack hdr;
+  PackWriter *w = nullptr;
+
+  PackSink(File &out, bool isPatch) : f(out), patch(isPatch) {}
+  ~PackSink() {
+    delete tp;
+    delete w;
+  }
+  void decide() {
+    decided = true;
+    raw = patch || (seen == 4 && !memcmp(head, TZ_MAGIC, 4));
+    if (raw) return;
+    tp = new ToonParser();
+    checkEntries(*tp, hdr);
+    w = new PackWriter(f);
+  }
+  bool take(const uint8_t *p, size_t n) {
+    if (!n) return true;
+    bool ok = raw ? f.write(p, n) == n : tp->feed(p, n) && w->write(p, n);
+    full = full || (!ok && !(tp && tp->failed));
+    return ok;
+  }
+  size_t write(const uint8_t *p, size_t n) override {
+    got += n;
+    if (progress) *progress = got;
+    size_t i = 0;
+    if (!decided) {
+      while (seen < 4 && i < n) head[seen++] = p[i++];
+      if (seen < 4) return n;
+      decide();
+      if (!take(head, seen)) return 0;
+    }
+    return take(p + i, n - i) ? n : 0;
+  }
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  int available() override { return 0; }
+  int read() override { return -1; }
+  int peek() override { return -1; }
+  void flush() {}
+
+  bool rejected() const { return tp && tp->failed; }
+  bool finish() {
+    if (!decided) {
+      decide();
+      if (!take(head, seen)) return false;
+    }
+    if (raw) return true;
+    if (!tp->finish()) return false;
+    full = !w->finish();
+    return !full;
+  }
+};
+
+// Apply the patch in src to the pack at path, then swap the result in
+// like an install.
+static int patchModel(PackFile &src, const String &path, String &msg) {
+  std::lock_guard<std::mutex> g(gInstallLock);
+  uint32_t t0 = millis();
+  PatchStats st;
+  // patchPack drops its pin on the set and its reader of path on return,
+  // so the swap below finds the old pack held only by running prompts:
+  // refcounted, it outlives them, and if it is lazy its file is copied
+  // aside to MODEL_RETIRED_DIR (activateNext)
+  int code = patchPack(src, path, MODEL_NEXT_PATH, st, msg);
+  if (code != 200) return code;
+  if (!activateNext(MODEL_NEXT_PATH, path)) {
+    msg = "cannot compile or store the patched model — the old one stays "
+          "active";
+    return 500;
+  }
+  Serial.printf("[model] patched %s: %d replaced, %d added, %d deleted, %d "
+                "entries, %u ms\n",
+                path.c_str(), st.replaced, st.added, st.deleted, st.count,
+                (unsigned)(millis() - t0));
+  msg = String("patched ") + path + ": " + st.replaced + " replaced, " +
+        st.added + " added, " + st.deleted + " deleted — " + st.count +
+        " entries, now active.";
+  return 200;
+}
+
+// Finish a pack or patch that sink streamed into tmp through f, then
+// install it, or apply it, as the pack at path.
+static int installStreamed(PackSink &sink, File &f, const char *tmp,
+                           const String &path, uint32_t t0, String &msg) {
+  bool ok = !sink.rejected() && sink.finish();
+  size_t stored = f.size();
+  f.close();
+  if (!ok) {
+    LittleFS.remove(tmp);
+    if (sink.rejected()) {
+      msg = String("rejected: ") + sink.tp->err + " (line " +
+            sink.tp->errLine + ")";
+      return 422;
+    }
+    msg = "cannot write model file — is the filesystem full?";
+    return 500;
+  }
+  PackFile pf;
+  if (sink.patch) {
+    int code = 500;
+    if (pf.open(tmp))
+      code = patchModel(pf, path, msg);
+    else
+      msg = "cannot read the patch";
+    pf.close();
+    LittleFS.remove(tmp);
+    return code;
+  }
+  int count = sink.raw ? 0 : sink.tp->count;
+  size_t text = sink.got;
+  if (sink.raw) {  // TZ1: checked now, from the file
+    String err;
+    int line = 0;
+    ok = pf.open(tmp) && validateToon(pf, sink.hdr, count, err, line);
+    text = pf.size;
+    pf.close();
+    if (!ok) {
+      LittleFS.remove(tmp);
+      msg = err.length() ? String("rejected: ") + err + " (line " + line + ")"
+                         : String("rejected: corrupt compressed pack");
+      return 422;
+    }
+  }
+  std::lock_guard<std::mutex> g(gInstallLock);
+  return finishInstall(tmp, path, sink.hdr, count, text, stored, t0, msg);
+}
+
+// An upload in flight. Chunks go straight to a temporary file — a pack's
+// through a PackSink, checked on the way — so RAM holds one chunk however
+// large the file. The route's handler runs once the body is in.
+struct Upload {
+  File f;
+  PackSink *sink = nullptr;  // pack and patch uploads
+  const char *tmp = nullptr;
+  uint32_t got = 0, t0 = 0;
+  bool full = false;         // a write failed
+};
+static Upload gUpload;
+
+static void endUpload() {
+  Upload &u = gUpload;
+  delete u.sink;
+  u.sink = nullptr;
+  if (u.f) u.f.close();
+  if (u.tmp) LittleFS.remove(u.tmp);  // gone already once installed
+  u.tmp = nullptr;
+  u.got = 0;
+  u.full = false;
+}
+
+static void uploadChunk(const char *tmp, bool pack, bool patch) {
   HTTPUpload &up = server.upload();
+  Upload &u = gUpload;
   if (up.status == UPLOAD_FILE_START) {
-    uploadBuf.clear();
-    uploadTooBig = false;
+    endUpload();
+    u.tmp = tmp;
+    u.t0 = millis();
+    u.f = LittleFS.open(tmp, "w");
+    u.full = !u.f;
+    if (pack) u.sink = new PackSink(u.f, patch);
   } else if (up.status == UPLOAD_FILE_WRITE) {
-    if (uploadBuf.size() + up.currentSize <= MAX_UPLOAD_SIZE)
-      uploadBuf.insert(uploadBuf.end(), up.buf, up.buf + up.currentSize);
-    else
-      uploadTooBig = true;
+    u.got += up.currentSize;
+    if (u.sink)
+      u.sink->write(up.buf, up.currentSize);  // a refusal sticks in sink
+    else if (!u.full)
+      u.full = u.f.write(up.buf, up.currentSize) != up.currentSize;
   } else if (up.status == UPLOAD_FILE_END) {
-    Serial.printf("[upload] received %u bytes\n", (unsigned)uploadBuf.size());
+    Serial.printf("[upload] received %u bytes\n", (unsigned)u.got);
+  } else if (up.status == UPLOAD_FILE_ABORTED) {
+    endUpload();
+  }
+}
+
+static void handleModelChunk() { uploadChunk(MODEL_UPLOAD_PATH, true, false); }
+static void handlePatchChunk() { uploadChunk(MODEL_UPLOAD_PATH, true, true); }
+static void handleWasmChunk() { uploadChunk(WASM_UPLOAD_PATH, false, false); }
+
+// End of a pack or patch upload: install or apply what arrived; none is
+// the reply when nothing did.
+static void handlePackUpload(const char *none) {
+  String path = packArg(), msg;
+  int code = 400;
+  if (!path.length())
+    msg = "bad pack name";
+  else if (!gUpload.sink || !gUpload.got)
+    msg = none;
+  else
+    code = installStreamed(*gUpload.sink, gUpload.f, MODEL_UPLOAD_PATH, path,
+                           gUpload.t0, msg);
+  endUpload();
+  server.send(code, "text/plain; charset=utf-8", msg);
+}
+
+static void handleModelUpload() { handlePackUpload("no model file received"); }
+static void handleModelPatch() { handlePackUpload("no patch received"); }
+
+// wasm3 runs a module from RAM: the upload is read back from its file
+// into one block of exactly its size, PSRAM when present.
+static WasmCall wasmLimitArgs() {
+  WasmCall limits;
+  if (server.hasArg("limit_ms"))
+    limits.limitMs = server.arg("limit_ms").toInt();
+  if (server.hasArg("steps")) limits.limitSteps = server.arg("steps").toInt();
+  return limits;
+}
+
+static void wasmQueued(int id) {
+  if (!id) {
+    server.send(503, "text/plain",
+                "wasm worker busy — every job slot is queued or running");
+    return;
   }
+  server.send(202, "text/plain; charset=utf-8",
+              String("wasm job ") + id +
+                  " queued — result at /api/wasm/job?id=" + id);
 }
 
 static void handleWasmRun() {
-  if (uploadTooBig) {
-    uploadBuf.clear();
-    server.send(413, "text/plain", "module too big (max 96 KB)");
+  size_t n = gUpload.got;
+  bool full = gUpload.full;
+  if (gUpload.f) gUpload.f.close();
+  if (!n || full) {
+    endUpload();
+    server.send(n ? 500 : 400, "text/plain",
+                n ? "cannot store the module — is the filesystem full?"
+                  : "no .wasm module received");
     return;
   }
-  if (uploadBuf.empty()) {
-    server.send(400, "text/plain", "no .wasm module received");
+  uint8_t *mod = imgRealloc(nullptr, n);
+  File f = LittleFS.open(WASM_UPLOAD_PATH, "r");
+  bool ok = mod && f && f.read(mod, n) == n;
+  if (f) f.close();
+  endUpload();
+  if (!ok) {
+    free(mod);
+    server.send(mod ? 500 : 413, "text/plain",
+                mod ? String("cannot read the module back")
+                    : String("module too big for free RAM (") + (int)n +
+                          " bytes)");
     return;
   }
   String fn = server.arg("func");
   if (fn.length() == 0) fn = "fib";
 
-  String toks[8];
-  const char *argv[8];
-  uint32_t argc = 0;
   String s = server.arg("args");
-  int i = 0, len = s.length();
-  while (i < len && argc < 8) {
-    while (i < len && (s[i] == ' ' || s[i] == ',')) i++;
-    int j = i;
-    while (j < len && s[j] != ' ' && s[j] != ',') j++;
-    if (j > i) {
-      toks[argc] = s.substring(i, j);
-      argv[argc] = toks[argc].c_str();
-      argc++;
-    }
-    i = j;
-  }
-
-  Serial.printf("[wasm] run %s(%s) from %u-byte upload\n", fn.c_str(),
-                s.c_str(), (unsigned)uploadBuf.size());
-  int64_t us = 0;
-  String r = runWasmModule(uploadBuf.data(), uploadBuf.size(), fn.c_str(), argc,
-                           argv, &us);
-  uploadBuf.clear();
-  uploadBuf.shrink_to_fit();
-
-  char tbuf[48];
-  snprintf(tbuf, sizeof(tbuf), "%.2f ms", us / 1000.0);
-  server.send(200, "text/plain; charset=utf-8",
-              fn + "(" + s + ") = " + r + "\n(your .wasm, run on-chip in " +
-                  tbuf + ")");
+  int id = wasmSubmit(mod, n, true, fn, s, fn + "(" + s + ")",
+                      wasmLimitArgs());
+  if (id)
+    Serial.printf("[wasm] job %d: %s(%s) from %u-byte upload\n", id,
+                  fn.c_str(), s.c_str(), (unsigned)n);
+  wasmQueued(id);
 }
 
-// Validate TOON model bytes, save to FS, respond, reboot with the new brain.
-static void installModel(const uint8_t *bytes, size_t len) {
-  String text;
-  text.concat((const char *)bytes, len);
-  Model m;
-  String err;
-  if (!parseToon(text, m, err)) {
-    server.send(422, "text/plain", String("rejected: ") + err);
-    return;
-  }
-  File f = LittleFS.open(MODEL_PATH, "w");
-  if (!f) {
-    server.send(500, "text/plain", "cannot write model file");
+// POST /api/wasm/call?name=<module>&func=: an installed module called
+// through the byte-buffer ABI, with the request body (or an input= field)
+// as its input. The output is at /api/wasm/job?id=N&raw=1.
+static void handleWasmCall() {
+  String name = server.arg("name");
+  String fn = server.hasArg("func") ? server.arg("func") : name;
+  String path = wasmPath(name), err;
+  if (!path.length()) {
+    server.send(400, "text/plain",
+                "bad module name — letters, digits, - and _");
     return;
   }
-  f.write(bytes, len);
-  f.close();
-  Serial.printf("[model] installed \"%s\" v%d (%u entries) — rebooting\n",
-                m.name.c_str(), m.version, (unsigned)m.entries.size());
-  server.send(200, "text/plain; charset=utf-8",
-              String("knowledge model \"") + m.name + "\" v" + m.version +
-                  " installed (" + (int)m.entries.size() +
-                  " entries, TOON). Rebooting — the page reconnects in a few "
-                  "seconds. The primary hardware model is unaffected.");
-  delay(500);
-  ESP.restart();
-}
-
-static void handleModelUpload() {
-  if (uploadTooBig) {
-    uploadBuf.clear();
-    server.send(413, "text/plain", "model too big (max 96 KB)");
+  size_t n = 0;
+  uint8_t *mod = wasmReadFile(path, n, err);
+  if (!mod) {
+    server.send(404, "text/plain", err);
     return;
   }
-  if (uploadBuf.empty()) {
-    server.send(400, "text/plain", "no model file received");
+  String input = server.hasArg("input") ? server.arg("input")
+                                        : server.arg("plain");
+  size_t inLen = input.length();
+  wasmTouch(name);
+  int id = wasmSubmit(mod, n, true, fn, String(),
+                      name + "." + fn + "(" + (unsigned)inLen + " bytes)",
+                      wasmLimitArgs(), &input);
+  if (id)
+    Serial.printf("[wasm] job %d: %s.%s on %u input bytes\n", id,
+                  name.c_str(), fn.c_str(), (unsigned)inLen);
+  wasmQueued(id);
+}
+
+// ?raw=1: a finished byte-buffer job's output bytes alone, once; after
+// that the job reads as its text result.
+static void handleWasmJob() {
+  int id = server.arg("id").toInt();
+  String out;
+  if (server.arg("raw") == "1" && wasmJobOutput(id, out)) {
+    server.send(200, "application/octet-stream", out);
     return;
   }
-  installModel(uploadBuf.data(), uploadBuf.size());
-  uploadBuf.clear();
-  uploadBuf.shrink_to_fit();
+  server.send(200, "text/plain; charset=utf-8", wasmJobText(id));
 }
 
-static void handleModelFetch() {
-  String url = server.arg("url");
-  if (!url.length()) {
-    server.send(400, "text/plain", "missing url");
+// POST /api/wasm/module?name=<name>: keep the upload as WASM_DIR/<name>.wasm,
+// replacing a module of that name. It must parse and load first, which
+// also leaves it warm in the runtime cache.
+static void handleWasmInstall() {
+  String name = server.arg("name"), path = wasmPath(name), err;
+  size_t n = gUpload.got;
+  bool full = gUpload.full;
+  if (gUpload.f) gUpload.f.close();
+  int code = 200;
+  if (!path.length()) {
+    code = 400;
+    err = "bad module name — letters, digits, - and _ (max 24)";
+  } else if (!n || full) {
+    code = n ? 500 : 400;
+    err = n ? "cannot store the module — is the filesystem full?"
+            : "no .wasm module received";
+  } else {
+    uint8_t *mod = wasmReadFile(WASM_UPLOAD_PATH, n, err);
+    WasmCall call;
+    std::lock_guard<std::mutex> g(gWasmLock);
+    if (!mod)
+      code = 413;
+    else if (!wasmSlot(mod, n, true, call, err))
+      code = 422;
+  }
+  if (code == 200) {
+    LittleFS.mkdir(WASM_DIR);
+    // replaces a module of that name in one step: one or the other is
+    // there after a power cut, never neither
+    if (!LittleFS.rename(WASM_UPLOAD_PATH, path)) {
+      code = 500;
+      err = "cannot move the module into place — the old one stays";
+    }
+  }
+  endUpload();
+  if (code != 200) {
+    server.send(code, "text/plain; charset=utf-8", err);
     return;
   }
-  if (WiFi.status() != WL_CONNECTED) {
-    server.send(503, "text/plain",
-                "not connected to a WiFi network — no internet to fetch from");
+  Serial.printf("[wasm] installed %s (%u bytes)\n", name.c_str(),
+                (unsigned)n);
+  schedModule(name, false);
+  server.send(200, "text/plain; charset=utf-8",
+              String("installed module ") + name + " (" + (int)n +
+                  " bytes) — run it with `run " + name + " [func] args`");
+}
+
+static void handleWasmDelete() {
+  String name = server.arg("name"), path = wasmPath(name);
+  if (!path.length() || !LittleFS.exists(path)) {
+    server.send(404, "text/plain", "no such module");
     return;
   }
-  Serial.printf("[model] fetching %s\n", url.c_str());
+  LittleFS.remove(path);
+  wasmForget(name);
+  schedModule(name, true);
+  server.send(200, "text/plain", String("deleted module ") + name);
+}
+
+// GET /api/wasm/sched: every schedule (?id=N: its results, newest first).
+// POST ?name=&func=&args=&every_ms= adds one; DELETE ?id= stops one.
+static void handleSchedList() {
+  server.send(200, "text/plain; charset=utf-8",
+              schedText(server.arg("id").toInt()));
+}
+
+static void handleSchedAdd() {
+  String name = server.arg("name");
+  String fn = server.hasArg("func") ? server.arg("func") : name;
+  String r = schedAdd(name, fn, server.arg("args"),
+                      server.arg("every_ms").toInt());
+  server.send(r.startsWith("schedule ") ? 201 : 400,
+              "text/plain; charset=utf-8", r);
+}
+
+static void handleSchedDelete() {
+  String r = schedStop(server.arg("id").toInt());
+  server.send(r.startsWith("stopped ") ? 200 : 404,
+              "text/plain; charset=utf-8", r);
+}
+
+static void handleWasmModules() {
+  String list = wasmList();
+  server.send(200, "text/plain", list.length() ? list : String("(none)\n"));
+}
+
+// A background fetch: the body streams into MODEL_FETCH_PATH, checked as
+// it arrives, then is installed (or applied as a patch) like an upload.
+// One runs at a time; the last one stays queryable by its id.
+struct FetchJob {
+  int id = 0;
+  String url, path;
+  bool patch = false;
+  std::atomic<bool> running{false};
+  std::atomic<uint32_t> got{0};  // body bytes so far
+  int32_t total = -1;            // Content-Length, -1 if not sent
+  int code = 0;                  // the outcome, as an HTTP status
+  String result;
+};
+static FetchJob gFetch;
+
+static int runFetch(FetchJob &j, String &msg) {
+  uint32_t t0 = millis();
   HTTPClient http;
   WiFiClientSecure tls;
   WiFiClient plainClient;
   bool ok;
-  if (url.startsWith("https")) {
+  if (j.url.startsWith("https")) {
     tls.setInsecure();  // model registry TLS without a cert bundle
-    ok = http.begin(tls, url);
+    ok = http.begin(tls, j.url);
   } else {
-    ok = http.begin(plainClient, url);
+    ok = http.begin(plainClient, j.url);
   }
   if (!ok) {
-    server.send(400, "text/plain", "bad url");
-    return;
+    msg = "bad url";
+    return 400;
   }
   int code = http.GET();
   if (code != HTTP_CODE_OK) {
     http.end();
-    server.send(502, "text/plain", String("fetch failed: HTTP ") + code);
-    return;
+    msg = String("fetch failed: HTTP ") + code;
+    return 502;
+  }
+  j.total = http.getSize();
+  File f = LittleFS.open(MODEL_FETCH_PATH, "w");
+  if (!f) {
+    http.end();
+    msg = "cannot write model file";
+    return 500;
   }
-  String body = http.getString();
+  PackSink sink(f, j.patch);
+  sink.progress = &j.got;
+  int sent = http.writeToStream(&sink);
   http.end();
-  if (body.length() == 0 || body.length() > MAX_UPLOAD_SIZE) {
-    server.send(422, "text/plain",
-                String("bad size: ") + body.length() + " bytes (max 96 KB)");
+  if (sent < 0 && !sink.rejected() && !sink.full) {
+    f.close();
+    LittleFS.remove(MODEL_FETCH_PATH);
+    msg = String("fetch failed: ") + HTTPClient::errorToString(sent);
+    return 502;
+  }
+  return installStreamed(sink, f, MODEL_FETCH_PATH, j.path, t0, msg);
+}
+
+static void fetchTask(void *) {
+  String msg;
+  int code = runFetch(gFetch, msg);
+  if (code != 200)
+    Serial.printf("[model] fetch job %d failed: %s\n", gFetch.id, msg.c_str());
+  gFetch.code = code;
+  gFetch.result = msg;
+  gFetch.running = false;
+  vTaskDelete(nullptr);
+}
+
+static void handleModelFetch() {
+  String url = server.arg("url"), path = packArg();
+  if (!url.length()) {
+    server.send(400, "text/plain", "missing url");
+    return;
+  }
+  if (!path.length()) {
+    server.send(400, "text/plain", "bad pack name");
+    return;
+  }
+  if (WiFi.status() != WL_CONNECTED) {
+    server.send(503, "text/plain",
+                "not connected to a WiFi network — no internet to fetch from");
     return;
   }
-  installModel((const uint8_t *)body.c_str(), body.length());
+  if (gFetch.running) {
+    server.send(409, "text/plain",
+                String("fetch job ") + gFetch.id + " is still running");
+    return;
+  }
+  gFetch.id++;
+  gFetch.url = url;
+  gFetch.path = path;
+  gFetch.patch = server.arg("patch") == "1";
+  gFetch.got = 0;
+  gFetch.total = -1;
+  gFetch.code = 0;
+  gFetch.result = "";
+  gFetch.running = true;
+  // a TLS handshake needs a deep stack, as on the loop task
+  if (xTaskCreate(fetchTask, "aura-fetch", 16 * 1024, nullptr, 1, nullptr) !=
+      pdPASS) {
+    gFetch.running = false;
+    server.send(503, "text/plain", "cannot start the fetch task");
+    return;
+  }
+  Serial.printf("[model] fetch job %d: %s\n", gFetch.id, url.c_str());
+  server.send(202, "text/plain",
+              String("fetch job ") + gFetch.id +
+                  " started — progress at /api/model/job?id=" + gFetch.id);
+}
+
+static void handleModelJob() {
+  if (!gFetch.id ||
+      (server.hasArg("id") && server.arg("id").toInt() != gFetch.id)) {
+    server.send(404, "text/plain", "no such fetch job");
+    return;
+  }
+  String out = String("job ") + gFetch.id + ": ";
+  if (gFetch.running) {
+    out += String("running — ") + (int)gFetch.got + " bytes";
+    if (gFetch.total >= 0) out += String(" of ") + (int)gFetch.total;
+  } else {
+    out += gFetch.code == 200 ? "done — " : "failed — ";
+    out += gFetch.result;
+  }
+  server.send(200, "text/plain; charset=utf-8", out);
 }
 
 static void handleModelGet() {
-  File f = LittleFS.open(MODEL_PATH, "r");
-  if (!f) {
+  String path = packArg();
+  PackFile f;
+  if (!path.length() || !f.open(path.c_str())) {
     server.send(404, "text/plain", "no model file");
     return;
   }
-  server.streamFile(f, "text/plain; charset=utf-8");
+  {  // what a patch for this pack names as its base
+    LiveModels live;
+    for (const Model *m : live->packs)
+      if (m->src == path) {
+        char hash[9];
+        snprintf(hash, sizeof(hash), "%08x", (unsigned)m->img->srcHash);
+        server.sendHeader("X-Model-Hash", hash);
+      }
+  }
+  if (!f.z || server.arg("z") == "1") {  // as stored
+    f.f.seek(0);
+    server.streamFile(f.f, f.z ? "application/octet-stream"
+                               : "text/plain; charset=utf-8");
+    f.close();
+    return;
+  }
+  server.setContentLength(f.size);
+  server.send(200, "text/plain; charset=utf-8", "");
+  char buf[512];
+  size_t n;
+  while ((n = f.read((uint8_t *)buf, sizeof(buf))) > 0)
+    server.sendContent(buf, n);
   f.close();
 }
 
 static void handleModelInfo() {
-  if (!gModel.ok) {
+  LiveModels live;
+  if (live->packs.empty()) {
     server.send(200, "text/plain", "hw + no knowledge model");
     return;
   }
-  server.send(200, "text/plain; charset=utf-8",
-              String("hw + ") + gModel.name + " v" + gModel.version + " · " +
-                  (int)gModel.entries.size() + " topics");
+  String out = "hw";
+  for (const Model *m : live->packs)
+    out += String(" + ") + m->name + " v" + m->version + " · " +
+           (int)m->nEntries + " topics";
+  server.send(200, "text/plain; charset=utf-8", out);
 }
 
 // ------------------------------------------------------------- page ---------
@@ -1029,18 +5867,21 @@ details p{color:var(--mut);margin-top:6px}
 </div>
 <form id="f"><input id="inp" placeholder="Ask or command... e.g. nyalakan pin 5 / what is scada" autocomplete="off"><button>Send</button></form>
 <details><summary>Knowledge model (TOON) — view / swap the brain</summary>
-<p>The PRIMARY hardware model is built into firmware and never replaced. Knowledge models are TOON packs in flash: install one and the chip reboots with a new domain. <a href="/api/model" style="color:var(--ac)" download="model.toon">Download current model</a></p>
+<p>The PRIMARY hardware model is built into firmware and never replaced. Knowledge models are TOON packs in flash: install one and it takes over the next prompt, no reboot. Name a pack to load it alongside the others instead of replacing the default one. <a href="/api/model" style="color:var(--ac)" download="model.toon">Download current model</a></p>
+<div class="wrow">
+<input type="text" id="mpk" placeholder="pack name (optional)" size="18">
+</div>
 <div class="wrow">
 <input type="file" id="mf" accept=".toon,.txt,text/plain">
-<button type="button" onclick="upModel()">Install &amp; reboot</button>
+<button type="button" onclick="upModel()">Install</button>
 </div>
 <div class="wrow">
 <input type="text" id="murl" placeholder="https://... model.toon URL" size="34">
-<button type="button" onclick="fetchModel()">Fetch &amp; reboot</button>
+<button type="button" onclick="fetchModel()">Fetch</button>
 </div>
 </details>
 <details><summary>Run your own .wasm on the chip</summary>
-<p>Freestanding module (no WASI/imports), exported function, numeric args. Max 96 KB.</p>
+<p>Freestanding module (no WASI/imports), exported function, numeric args. Any size that fits in free RAM.</p>
 <div class="wrow">
 <input type="file" id="wf" accept=".wasm">
 <input type="text" id="wfn" placeholder="function" value="fib" size="10">
@@ -1055,19 +5896,23 @@ function q(t){inp.value=t;f.requestSubmit()}
 f.onsubmit=async function(e){e.preventDefault();var t=inp.value.trim();if(!t)return;inp.value='';add('you',t);var w=add('esp','...');
 try{var r=await fetch('/api/prompt',{method:'POST',headers:{'Content-Type':'text/plain'},body:t});w.textContent=await r.text();if(!r.ok)w.classList.add('err')}
 catch(err){w.textContent='network error: '+err;w.classList.add('err')}};
-function rebootWait(w){w.textContent+='\n\nWaiting for reboot...';setTimeout(function(){location.reload()},7000)}
+function modelInfo(){fetch('/api/model/info').then(function(r){return r.text()}).then(function(t){document.getElementById('mi').textContent='model: '+t})}
+function packQ(){var p=document.getElementById('mpk').value.trim();return p?'?pack='+encodeURIComponent(p):''}
 async function upModel(){var file=document.getElementById('mf').files[0];
 if(!file){add('esp','choose a model .toon file first').classList.add('err');return}
 add('you','[install model] '+file.name);var w=add('esp','installing...');
 var fd=new FormData();fd.append('model',file,'model.toon');
-try{var r=await fetch('/api/model',{method:'POST',body:fd});w.textContent=await r.text();
-if(r.ok)rebootWait(w);else w.classList.add('err')}
+try{var r=await fetch('/api/model'+packQ(),{method:'POST',body:fd});w.textContent=await r.text();
+if(r.ok)modelInfo();else w.classList.add('err')}
 catch(err){w.textContent='network error: '+err;w.classList.add('err')}}
 async function fetchModel(){var u=document.getElementById('murl').value.trim();
 if(!u){add('esp','enter a model URL first').classList.add('err');return}
 add('you','[fetch model] '+u);var w=add('esp','fetching on-chip...');
-try{var r=await fetch('/api/model/fetch',{method:'POST',headers:{'Content-Type':'application/x-www-form-urlencoded'},body:'url='+encodeURIComponent(u)});
-w.textContent=await r.text();if(r.ok)rebootWait(w);else w.classList.add('err')}
+try{var r=await fetch('/api/model/fetch'+packQ(),{method:'POST',headers:{'Content-Type':'application/x-www-form-urlencoded'},body:'url='+encodeURIComponent(u)});
+var t=await r.text();w.textContent=t;if(r.status!=202){w.classList.add('err');return}
+var id=t.match(/job (\d+)/)[1];
+do{await new Promise(function(k){setTimeout(k,500)});t=await(await fetch('/api/model/job?id='+id)).text();w.textContent=t}while(t.indexOf(': running')>0);
+if(t.indexOf(': done')>0)modelInfo();else w.classList.add('err')}
 catch(err){w.textContent='network error: '+err;w.classList.add('err')}}
 async function runWasm(){var file=document.getElementById('wf').files[0];
 if(!file){add('esp','choose a .wasm file first').classList.add('err');return}
@@ -1075,9 +5920,12 @@ var fn=document.getElementById('wfn').value.trim()||'fib';
 var args=document.getElementById('wargs').value.trim();
 add('you','[upload] '+file.name+' -> '+fn+'('+args+')');var w=add('esp','running on chip...');
 var fd=new FormData();fd.append('func',fn);fd.append('args',args);fd.append('module',file,'m.wasm');
-try{var r=await fetch('/api/wasm',{method:'POST',body:fd});w.textContent=await r.text();if(!r.ok)w.classList.add('err')}
+try{var r=await fetch('/api/wasm',{method:'POST',body:fd});var t=await r.text();w.textContent=t;if(r.status!=202){w.classList.add('err');return}
+var id=t.match(/job (\d+)/)[1];
+do{await new Promise(function(k){setTimeout(k,300)});t=await(await fetch('/api/wasm/job?id='+id)).text();w.textContent=t}while(/^job \d+: (queued|running)/.test(t));
+if(t.indexOf('error')>=0)w.classList.add('err')}
 catch(err){w.textContent='network error: '+err;w.classList.add('err')}}
-fetch('/api/model/info').then(function(r){return r.text()}).then(function(t){document.getElementById('mi').textContent='model: '+t});
+modelInfo();
 add('esp','Halo! 👋 I am AURA — on-device intelligence.\nPRIMARY model (built-in): hardware — try: hw, led on, cek suhu, i2c scan, nyalakan pin 5\nADDITIONAL model (swappable): knowledge — try: what is a plc — or type help');
 </script></body></html>)html";
 
@@ -1098,42 +5946,36 @@ void AuraClass::begin(const Config &cfg) {
   delay(300);
   Serial.println("\n=== AURA · on-device intelligence ===");
 
+  bootPhase("fs mount");
   if (!LittleFS.begin(true)) {
     Serial.println("[fs] ERROR: LittleFS mount failed");
   } else {
     Serial.printf("[fs] mounted, %u/%u KB used\n",
                   (unsigned)(LittleFS.usedBytes() / 1024),
                   (unsigned)(LittleFS.totalBytes() / 1024));
+    bootPhase("model file");
     ensureModelFile();
-    loadModel();
+    bootPhase("load models");
+    loadModels();
     // ship a newer factory model? upgrade the on-flash copy in place
-    if (gModel.ok && gModel.name == "automation" &&
-        gModel.author == "Professor Claude" && gModel.version < 3) {
-      Serial.printf("[model] upgrading factory model v%d -> v3\n",
-                    gModel.version);
-      File f = LittleFS.open(MODEL_PATH, "w");
-      if (f) {
-        f.print(FPSTR(DEFAULT_MODEL));
-        f.close();
-        loadModel();
-      }
+    int factory = 0;
+    {
+      LiveModels live;
+      const Model *m = live->packs.size() ? live->packs[0] : nullptr;
+      if (m && m->src == MODEL_PATH && !strcmp(m->name, "automation") &&
+          !strcmp(m->author, "Professor Claude"))
+        factory = m->version;
+    }
+    if (factory && factory < 3) {
+      bootPhase("factory upgrade");
+      Serial.printf("[model] upgrading factory model v%d -> v3\n", factory);
+      if (writePack(MODEL_PATH, (const uint8_t *)DEFAULT_MODEL,
+                    sizeof(DEFAULT_MODEL) - 1))
+        loadModels();
     }
   }
 
-  const char *argv[1] = {"24"};
-  int64_t us = 0;
-  String r = runWasmModule(FIB_WASM, sizeof(FIB_WASM), "fib", 1, argv, &us);
-  Serial.printf("wasm self-test: fib(24) = %s in %.2f ms — %s\n", r.c_str(),
-                us / 1000.0, r == "46368" ? "OK" : "UNEXPECTED");
-  if (gModel.ok) {
-    String a = askModel("what is a plc");
-    a.replace("\n", " ");
-    Serial.printf("knowledge self-test: %.90s...\n", a.c_str());
-  }
-  String hwt = tryPrimary("cek suhu sekarang");
-  hwt.replace("\n", " ");
-  Serial.printf("primary self-test: %.90s\n", hwt.c_str());
-
+  bootPhase("wifi setup");
   WiFi.mode(WIFI_AP_STA);
   WiFi.setHostname(gCfg.hostname);
   WiFi.onEvent(
@@ -1147,6 +5989,7 @@ void AuraClass::begin(const Config &cfg) {
                  rr == WIFI_REASON_HANDSHAKE_TIMEOUT)
           hint = " (auth failed — wrong password?)";
         Serial.printf("[wifi] disconnected, reason %d%s\n", rr, hint);
+        gSta.dropped = true;
       },
       ARDUINO_EVENT_WIFI_STA_DISCONNECTED);
   WiFi.onEvent(
@@ -1155,46 +5998,70 @@ void AuraClass::begin(const Config &cfg) {
                       WiFi.localIP().toString().c_str());
       },
       ARDUINO_EVENT_WIFI_STA_GOT_IP);
-  if (gCfg.ssid && gCfg.ssid[0]) {
-    WiFi.setAutoReconnect(true);
-    WiFi.begin(gCfg.ssid, gCfg.pass);
-    Serial.printf("connecting to \"%s\"", gCfg.ssid);
-    uint32_t t0 = millis();
-    while (WiFi.status() != WL_CONNECTED && millis() - t0 < 20000) {
-      delay(250);
-      Serial.print('.');
-    }
-    Serial.println();
-  } else {
-    Serial.println("no station WiFi configured — AP-only mode");
-  }
-  // Fallback AP stays up either way; STA keeps retrying in loop()
+  // Fallback AP stays up either way; the station joins later from loop()
+  bootPhase("soft AP");
   WiFi.softAP(gCfg.apSsid, gCfg.apPass);
   Serial.printf("fallback AP \"%s\" pass \"%s\" — http://%s/\n", gCfg.apSsid,
                 gCfg.apPass, WiFi.softAPIP().toString().c_str());
+  bootPhase("mDNS");
   if (MDNS.begin(gCfg.hostname)) {
     MDNS.addService("http", "tcp", 80);
     Serial.printf("mDNS: http://%s.local/\n", gCfg.hostname);
   }
 
+  bootPhase("web server");
   server.on("/", HTTP_GET,
-            []() { server.send_P(200, "text/html", INDEX_HTML); });
+            []() {
+              bootServed();
+              server.send_P(200, "text/html", INDEX_HTML);
+            });
   server.on("/api/prompt", HTTP_POST, handlePrompt);
-  server.on("/api/wasm", HTTP_POST, handleWasmRun, handleUploadChunk);
+  server.on("/api/wasm", HTTP_POST, handleWasmRun, handleWasmChunk);
+  server.on("/api/wasm/module", HTTP_POST, handleWasmInstall,
+            handleWasmChunk);
+  server.on("/api/wasm/module", HTTP_DELETE, handleWasmDelete);
+  server.on("/api/wasm/modules", HTTP_GET, handleWasmModules);
+  server.on("/api/wasm/call", HTTP_POST, handleWasmCall);
+  server.on("/api/wasm/job", HTTP_GET, handleWasmJob);
+  server.on("/api/wasm/sched", HTTP_GET, handleSchedList);
+  server.on("/api/wasm/sched", HTTP_POST, handleSchedAdd);
+  server.on("/api/wasm/sched", HTTP_DELETE, handleSchedDelete);
   server.on("/api/model", HTTP_GET, handleModelGet);
-  server.on("/api/model", HTTP_POST, handleModelUpload, handleUploadChunk);
+  server.on("/api/model", HTTP_POST, handleModelUpload, handleModelChunk);
+  server.on("/api/model/patch", HTTP_POST, handleModelPatch,
+            handlePatchChunk);
   server.on("/api/model/fetch", HTTP_POST, handleModelFetch);
+  server.on("/api/model/job", HTTP_GET, handleModelJob);
   server.on("/api/model/info", HTTP_GET, handleModelInfo);
+  server.on("/api/boot", HTTP_GET,
+            []() { server.send(200, "text/plain", bootReport()); });
+  server.on("/api/bench/wasm", HTTP_GET, []() {
+    server.send(200, "text/plain; charset=utf-8", cmdBenchWasm());
+  });
   server.onNotFound([]() {
+    bootServed();
     server.sendHeader("Location", "/");
     server.send(302, "text/plain", "");
   });
   server.begin();
+  gBootReady = millis();
   Serial.println("web server running on port 80");
+  if (gCfg.ssid && gCfg.ssid[0]) {
+    WiFi.setAutoReconnect(false);  // staService() owns the retries
+    staJoin();
+  } else {
+    Serial.println("no station WiFi configured — AP-only mode");
+  }
+  if (xTaskCreate(selfTestTask, "aura-selftest", 16 * 1024, nullptr, 1,
+                  nullptr) != pdPASS)
+    Serial.println("[selftest] cannot start the self-test task");
+  bootPhase(nullptr);
+  Serial.println(bootSummary());
 }
 
 void AuraClass::loop() {
   server.handleClient();
+  staService();
   static uint32_t lastBeat = 0;
   if (millis() - lastBeat > 15000) {
     lastBeat = millis();
@@ -1205,10 +6072,7 @@ void AuraClass::loop() {
                     (unsigned)(ESP.getFreeHeap() / 1024),
                     sta ? WiFi.localIP().toString().c_str()
                         : WiFi.softAPIP().toString().c_str());
-    if (!sta && gCfg.ssid && gCfg.ssid[0]) {
-      Serial.printf("[wifi] retrying \"%s\"...\n", gCfg.ssid);
-      WiFi.begin(gCfg.ssid, gCfg.pass);
-    }
   }
   delay(2);
 }
+#endif  // AURA_HOST